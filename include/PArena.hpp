@@ -0,0 +1,225 @@
+/** \file PArena.hpp
+ *  \brief A monotonic (bump) allocator
+ *
+ * Memory is handed out by bumping an offset through a chain of blocks and is only given back all at once, either
+ * by resetting the arena or by rewinding it to a previously taken marker.  Intended for scratch data that shares
+ * a single lifetime such as per frame or per request buffers.
+ */
+
+#pragma once
+
+#ifndef PARENA_H
+#define PARENA_H
+
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#include <memory_resource>
+#define PARENA_HAS_PMR
+#endif
+#endif
+
+
+#define PARENA_DEFAULT_BLOCK_SIZE	(64 * 1024)
+#define PARENA_DEFAULT_ALIGN		16
+
+namespace PSTD {
+
+
+	/** \brief A position in an arena which it can later be rewound to */
+	struct PArenaMarker {
+		size_t _Block;
+		size_t _Offset;
+	};
+
+
+	/** \brief Monotonic bump allocator over a chain of blocks
+	 *
+	 * Destructors of objects placed in the arena are never run, so it should only hold objects that don't own
+	 * other resources.  Blocks are kept across resets and reused.
+	 */
+	class PArena {
+		public:
+
+		/** \brief Constructor
+		 * @param blockSize Size of each block requested from the system, larger allocations get a block of their own
+		 */
+		PArena(size_t blockSize = PARENA_DEFAULT_BLOCK_SIZE) :
+			_BlockSize(blockSize),
+			_CurBlock(0),
+			_CurOffset(0)
+		{
+			PArenaBlock block;
+			block._Mem = new char[_BlockSize];
+			block._Size = _BlockSize;
+			_Blocks.push_back(block);
+		};
+
+
+		//! Deconstructor
+		~PArena(void) {
+			for (size_t i = 0; i < _Blocks.size(); i++) {
+				delete[]_Blocks[i]._Mem;
+			}
+		};
+
+
+		/** \brief Allocate memory from the arena
+		 * @param size Number of bytes to allocate
+		 * @param align Alignment of the memory, must be a power of two
+		 * @return Allocated memory
+		 */
+		void *Allocate(size_t size, size_t align = PARENA_DEFAULT_ALIGN) {
+			PArenaBlock &block = _Blocks[_CurBlock];
+			uintptr_t start = ((uintptr_t)(block._Mem + _CurOffset) + (align - 1)) & ~((uintptr_t)align - 1);
+			size_t end = (size_t)(start - (uintptr_t)block._Mem) + size;
+
+			if (end <= block._Size) {
+				_CurOffset = end;
+				return (void *)start;
+			}
+			return Allocate_NextBlock(size, align);
+		};
+
+
+		/** \brief Allocate and default construct an object in the arena
+		 * @return Constructed object
+		 */
+		template <typename T>
+		T *Allocate_Object(void) {
+			return new (Allocate(sizeof(T), std::alignment_of<T>::value)) T();
+		};
+
+
+		/** \brief Copy a string into the arena
+		 * @param str String to copy
+		 * @param len Length of the string, not counting the terminator
+		 * @return Null terminated copy of the string
+		 */
+		char *Copy_String(const char *str, size_t len) {
+			char *copy = (char *)Allocate(len + 1, 1);
+			memcpy(copy, str, len);
+			copy[len] = 0;
+			return copy;
+		};
+
+		char *Copy_String(const char *str) { return Copy_String(str, strlen(str)); };
+
+
+		/** \brief Release everything allocated from the arena, keeping its blocks for reuse */
+		void Reset(void) {
+			_CurBlock = 0;
+			_CurOffset = 0;
+		};
+
+
+		/** \brief Get a marker for the current position of the arena
+		 * @return Marker which can be passed to Rewind
+		 */
+		PArenaMarker Get_Marker(void) const {
+			PArenaMarker marker;
+			marker._Block = _CurBlock;
+			marker._Offset = _CurOffset;
+			return marker;
+		};
+
+
+		/** \brief Release everything allocated since the marker was taken
+		 * @param marker Marker returned by Get_Marker
+		 */
+		void Rewind(const PArenaMarker &marker) {
+			_CurBlock = marker._Block;
+			_CurOffset = marker._Offset;
+		};
+
+
+		/** \brief Get the total number of bytes held by the arena's blocks
+		 * @return Capacity in bytes
+		 */
+		size_t Get_Capacity(void) const {
+			size_t cap = 0;
+			for (size_t i = 0; i < _Blocks.size(); i++) {
+				cap += _Blocks[i]._Size;
+			}
+			return cap;
+		};
+
+		private:
+		PArena(const PArena &);
+		PArena &operator=(const PArena &);
+
+		struct PArenaBlock {
+			char *_Mem;
+			size_t _Size;
+		};
+
+
+		// move on to the following block, putting a new one in place if it doesn't exist or is too small
+		void *Allocate_NextBlock(size_t size, size_t align) {
+			size_t next = _CurBlock + 1;
+			if ((next == _Blocks.size()) || (_Blocks[next]._Size < size + align)) {
+				PArenaBlock block;
+				block._Size = (size + align > _BlockSize) ? (size + align) : _BlockSize;
+				block._Mem = new char[block._Size];
+				_Blocks.insert(_Blocks.begin() + next, block);
+			}
+			_CurBlock = next;
+			_CurOffset = 0;
+			return Allocate(size, align);
+		};
+
+
+		size_t _BlockSize;							// Default size of each block
+		size_t _CurBlock;							// Block allocations are currently made from
+		size_t _CurOffset;							// Offset of the first free byte in the current block
+		std::vector<PArenaBlock> _Blocks;			// Chain of blocks in the order they are used
+	};
+
+
+	/** \brief Rewinds an arena to where it was when the scope was entered */
+	class PArenaScope {
+		public:
+		PArenaScope(PArena &arena) : _Arena(arena), _Marker(arena.Get_Marker()) {};
+		~PArenaScope(void) { _Arena.Rewind(_Marker); };
+
+		private:
+		PArenaScope(const PArenaScope &);
+		PArenaScope &operator=(const PArenaScope &);
+
+		PArena &_Arena;
+		PArenaMarker _Marker;
+	};
+
+
+#ifdef PARENA_HAS_PMR
+
+	/** \brief Polymorphic memory resource drawing from an arena
+	 *
+	 * Lets std::pmr containers (std::pmr::string, std::pmr::vector ...) allocate from an arena.  Deallocation is a
+	 * no-op, memory comes back when the arena is reset or rewound.
+	 */
+	class PArenaResource : public std::pmr::memory_resource {
+		public:
+		PArenaResource(PArena *arena) : _Arena(arena) {};
+
+		PArena *Get_Arena(void) { return _Arena; };
+
+		protected:
+		void *do_allocate(size_t bytes, size_t alignment) override { return _Arena->Allocate(bytes, alignment); };
+		void do_deallocate(void *, size_t, size_t) override {};
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; };
+
+		private:
+		PArena *_Arena;
+	};
+
+#endif
+
+}
+
+#endif
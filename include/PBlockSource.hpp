@@ -0,0 +1,206 @@
+/** \file PBlockSource.hpp
+ *  \brief Sources of raw memory blocks for the pooled memory managers
+ *
+ * A block source hands out and takes back large blocks of raw memory.  Any type providing
+ *   char *Allocate_Block(size_t bytes) - returning NULL on failure
+ *   void Free_Block(char *block, size_t bytes)
+ * can be used as the block source of a PoolMemManager.
+ */
+
+#pragma once
+
+#ifndef PBLOCKSOURCE_H
+#define PBLOCKSOURCE_H
+
+#include <stddef.h>
+#include <new>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+
+#define PBS_HUGE_PAGE_SIZE	(2 * 1024 * 1024)	// size huge page backed blocks are rounded up to
+#define PBS_PAGE_SIZE		4096
+#define PBS_MAX_NUMA_NODES	64							// highest NUMA node count PNumaBlockSource can bind to
+#define PBS_MPOL_BIND		2							// mbind policy binding pages strictly to the node mask
+
+namespace PSTD {
+
+
+	/** \brief Block source using the system heap */
+	class PNewBlockSource {
+		public:
+		char *Allocate_Block(size_t bytes) { return new (std::nothrow) char[bytes]; };
+		void Free_Block(char *block, size_t) { delete[]block; };
+	};
+
+
+	/** \brief Block source mapping anonymous memory directly from the OS
+	 *
+	 * Blocks can be backed by huge pages to cut TLB misses on large pools, and pre-faulted so the page fault
+	 * cost is paid when the pool grows rather than on first touch of each object.  If explicit huge pages are not
+	 * available the block falls back to normal pages, asking for transparent huge pages where supported.
+	 */
+	class PMMapBlockSource {
+		public:
+
+		/** \brief Constructor
+		 * @param hugePages Flag indicating if blocks should be backed by huge pages
+		 * @param prefault Flag indicating if the pages of a block should be faulted in when it is mapped
+		 */
+		explicit PMMapBlockSource(bool hugePages = true, bool prefault = true) : _HugePages(hugePages), _Prefault(prefault) {};
+
+		char *Allocate_Block(size_t bytes) {
+			size_t mapSize = Get_MapSize(bytes);
+
+#ifdef _MSC_VER
+			void *block = NULL;
+			if (_HugePages) {
+				block = VirtualAlloc(NULL, mapSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+			}
+			if (!block) {
+				block = VirtualAlloc(NULL, mapSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			}
+			if (block && _Prefault) {
+				for (size_t i = 0; i < mapSize; i += PBS_PAGE_SIZE) {
+					((volatile char *)block)[i] = 0;
+				}
+			}
+			return (char *)block;
+#else
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+			if (_Prefault) {
+				flags |= MAP_POPULATE;
+			}
+#endif
+
+			void *block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+			if (_HugePages) {
+				block = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+			}
+#endif
+
+			// no reserved huge pages, so map normal pages and ask for transparent huge pages instead
+			if (block == MAP_FAILED) {
+				block = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+				if (block == MAP_FAILED) {
+					return NULL;
+				}
+#ifdef MADV_HUGEPAGE
+				if (_HugePages) {
+					madvise(block, mapSize, MADV_HUGEPAGE);
+				}
+#endif
+			}
+			return (char *)block;
+#endif
+		};
+
+		void Free_Block(char *block, size_t bytes) {
+#ifdef _MSC_VER
+			VirtualFree(block, 0, MEM_RELEASE);
+#else
+			munmap(block, Get_MapSize(bytes));
+#endif
+		};
+
+		private:
+
+		// round a request up to a whole number of pages
+		size_t Get_MapSize(size_t bytes) {
+			size_t pageSize = (_HugePages) ? PBS_HUGE_PAGE_SIZE : PBS_PAGE_SIZE;
+			return (bytes + pageSize - 1) & ~(pageSize - 1);
+		};
+
+		bool _HugePages;
+		bool _Prefault;
+	};
+
+
+	/** \brief Block source placing blocks on a given NUMA node
+	 *
+	 * On Linux the mapping is bound to the node with mbind before it is touched and then pre-faulted.  Where the
+	 * binding fails (no NUMA support in the kernel, a node which does not exist, or a policy the process may not
+	 * set) the block is still handed out, but its pages land wherever first touch by the allocating thread puts
+	 * them.  Such blocks are counted, see Get_NumUnbound.
+	 */
+	class PNumaBlockSource {
+		public:
+
+		/** \brief Constructor
+		 * @param node NUMA node blocks should be placed on
+		 * @param hugePages Flag indicating if blocks should ask for transparent huge pages
+		 */
+		explicit PNumaBlockSource(int node = 0, bool hugePages = false) : _Node(node), _HugePages(hugePages), _NumUnbound(0) {};
+
+		char *Allocate_Block(size_t bytes) {
+			size_t mapSize = Get_MapSize(bytes);
+
+#ifdef _MSC_VER
+			return (char *)VirtualAllocExNuma(GetCurrentProcess(), NULL, mapSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, (DWORD)_Node);
+#else
+			void *block = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (block == MAP_FAILED) {
+				return NULL;
+			}
+#ifdef MADV_HUGEPAGE
+			if (_HugePages) {
+				madvise(block, mapSize, MADV_HUGEPAGE);
+			}
+#endif
+			bool bound = false;
+#ifdef SYS_mbind
+			if ((_Node >= 0) && (_Node < PBS_MAX_NUMA_NODES)) {
+				unsigned long nodeMask[PBS_MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = { 0 };
+				nodeMask[_Node / (8 * sizeof(unsigned long))] = 1UL << (_Node % (8 * sizeof(unsigned long)));
+				bound = (syscall(SYS_mbind, block, mapSize, PBS_MPOL_BIND, nodeMask, PBS_MAX_NUMA_NODES + 1, 0) == 0);
+			}
+#endif
+			if (!bound) {
+				_NumUnbound++;
+			}
+			for (size_t i = 0; i < mapSize; i += PBS_PAGE_SIZE) {
+				((volatile char *)block)[i] = 0;
+			}
+			return (char *)block;
+#endif
+		};
+
+		void Free_Block(char *block, size_t bytes) {
+#ifdef _MSC_VER
+			VirtualFree(block, 0, MEM_RELEASE);
+#else
+			munmap(block, Get_MapSize(bytes));
+#endif
+		};
+
+		int Get_Node(void) { return _Node; };
+
+		/** \brief Get the number of blocks which could not be bound to the node
+		 * @return Number of blocks placed by first touch instead, always 0 on Windows
+		 */
+		unsigned int Get_NumUnbound(void) const { return _NumUnbound; };
+
+		private:
+
+		// round a request up to a whole number of pages
+		size_t Get_MapSize(size_t bytes) {
+			size_t pageSize = (_HugePages) ? PBS_HUGE_PAGE_SIZE : PBS_PAGE_SIZE;
+			return (bytes + pageSize - 1) & ~(pageSize - 1);
+		};
+
+		int _Node;
+		bool _HugePages;
+		unsigned int _NumUnbound;				// Blocks the node binding failed for
+	};
+
+}
+
+#endif
@@ -0,0 +1,17 @@
+/** \file PCacheLine.hpp
+ *  \brief Cache line size shared by the pools and the concurrent containers
+ *
+ * Used to align chunks and to keep state written by different threads on separate cache lines.  Define
+ * PSTD_CACHELINE_SIZE before including any PSTD header to build for a target with a different line size.
+ */
+
+#pragma once
+
+#ifndef PCACHELINE_H
+#define PCACHELINE_H
+
+#ifndef PSTD_CACHELINE_SIZE
+#define PSTD_CACHELINE_SIZE		64
+#endif
+
+#endif
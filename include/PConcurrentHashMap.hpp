@@ -0,0 +1,409 @@
+/** \file PConcurrentHashMap.hpp
+ *  \brief Sharded hash map for read mostly data shared between threads
+ *
+ * Keys are spread over a fixed number of shards by the top bits of their hash.  Each shard is a small open
+ * addressing table guarded by a mutex for writers and a sequence counter for readers: a reader never takes a
+ * lock, it copies what it finds and retries if a writer touched the shard in the meantime.
+ */
+
+#pragma once
+
+#ifndef PCONCURRENTHASHMAP_H
+#define PCONCURRENTHASHMAP_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "PHashFunctions.hpp"
+#include "PCacheLine.hpp"
+
+
+#define PCHM_DEFAULT_SHARDS		64			// shards used when none are given, rounded up to a power of two
+#define PCHM_MIN_CAPACITY		16			// slots in a shard's first table
+#define PCHM_SPIN_COUNT			64			// reader retries before yielding to a writer holding the shard
+
+namespace PSTD {
+
+
+	/** \brief Concurrent hash map with lock free readers and per shard writer locks
+	 *
+	 * Get never blocks and is lock free against other readers; it only retries while a writer is changing the
+	 * same shard.  Set and Remove lock just the key's shard.  Because readers copy slots while a writer may be
+	 * changing them (the usual seqlock scheme) keys and values must be trivially copyable.  Tables replaced when
+	 * a shard grows are retired rather than freed, since a reader may still be walking them, and are released
+	 * when the map is destroyed; geometric growth keeps them below the size of the live tables.
+	 * \tparam K Type of the keys
+	 * \tparam V Type of the values
+	 * \tparam Hash Functor returning a 64 bit hash of a key
+	 * \tparam Eq Functor comparing two keys for equality
+	 */
+	template <typename K, typename V, typename Hash = PHashDefault<K>, typename Eq = std::equal_to<K>>
+	class PConcurrentHashMap {
+		static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value, "PConcurrentHashMap keys and values must be trivially copyable");
+
+		public:
+
+		/** \brief Constructor
+		 * @param initialSize Number of keys the map should hold before any shard has to grow
+		 * @param numShards Number of shards, rounded up to a power of two
+		 */
+		PConcurrentHashMap(unsigned int initialSize = 0, unsigned int numShards = PCHM_DEFAULT_SHARDS) :
+			_NumKeys(0)
+		{
+			_ShardBits = 0;
+			while ((1u << _ShardBits) < numShards) {
+				_ShardBits++;
+			}
+			_NumShards = 1u << _ShardBits;
+
+			// new[] only guarantees 16 byte alignment before C++17, so the shards are placed in a padded buffer
+			_ShardMem = new char[_NumShards * sizeof(Shard) + PSTD_CACHELINE_SIZE];
+			_Shards = reinterpret_cast<Shard *>(((uintptr_t)_ShardMem + PSTD_CACHELINE_SIZE - 1) & ~(uintptr_t)(PSTD_CACHELINE_SIZE - 1));
+			for (unsigned int i = 0; i < _NumShards; i++) {
+				new (&_Shards[i]) Shard();
+			}
+
+			unsigned int capacity = PCHM_MIN_CAPACITY;
+			while ((size_t)capacity * 3 < (size_t)(initialSize / _NumShards + 1) * 4) {
+				capacity <<= 1;
+			}
+			for (unsigned int i = 0; i < _NumShards; i++) {
+				_Shards[i]._Table.store(new Table(capacity), std::memory_order_relaxed);
+			}
+		};
+
+		~PConcurrentHashMap(void) {
+			for (unsigned int i = 0; i < _NumShards; i++) {
+				delete _Shards[i]._Table.load(std::memory_order_relaxed);
+				for (size_t j = 0; j < _Shards[i]._Retired.size(); j++) {
+					delete _Shards[i]._Retired[j];
+				}
+				_Shards[i].~Shard();
+			}
+			delete[] _ShardMem;
+		};
+
+
+		/** \brief Look up a key without taking any lock
+		 * @param key Key
+		 * @param val Receives the value if the key is found
+		 * @return True if the key was found
+		 */
+		bool Get(const K &key, V &val) const {
+			uint64_t hash = Get_Hash(key);
+			Shard &shard = Get_Shard(hash);
+			unsigned int spins = 0;
+
+			for (;;) {
+				uint32_t seq = shard._Seq.load(std::memory_order_acquire);
+				if (seq & 1) {
+					Backoff(spins);
+					continue;
+				}
+
+				Table *table = shard._Table.load(std::memory_order_acquire);
+				Slot found;
+				bool hit = table->Find(hash, key, _Eq, found);
+
+				// only trust the copy if no writer started in the meantime
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (shard._Seq.load(std::memory_order_relaxed) == seq) {
+					if (hit) {
+						val = found._Val;
+					}
+					return hit;
+				}
+				Backoff(spins);
+			}
+		};
+
+
+		/** \brief Add a key or replace the value of an existing one, locking only the key's shard
+		 * @param key Key
+		 * @param val Value to store
+		 */
+		void Set(const K &key, const V &val) {
+			uint64_t hash = Get_Hash(key);
+			Shard &shard = Get_Shard(hash);
+			std::lock_guard<std::mutex> lock(shard._Lock);
+			Table *table = shard._Table.load(std::memory_order_relaxed);
+
+			// grow into a new table which readers switch to once it is published
+			if ((size_t)(table->_NumKeys + 1) * 4 > (size_t)table->_Capacity * 3) {
+				Table *grown = new Table(table->_Capacity * 2);
+				Slot slot;
+				for (unsigned int i = 0; i < table->_Capacity; i++) {
+					if (table->Get_SlotHash(i)) {
+						table->Load_Slot(i, slot);
+						grown->Insert(slot);
+					}
+				}
+				shard._Table.store(grown, std::memory_order_release);
+				shard._Retired.push_back(table);
+				table = grown;
+			}
+
+			Begin_Write(shard);
+			Slot slot;
+			slot._Hash = hash;
+			slot._Key = key;
+			slot._Val = val;
+			if (table->Replace(slot, _Eq)) {
+				End_Write(shard);
+				return;
+			}
+			table->Insert(slot);
+			End_Write(shard);
+			_NumKeys.fetch_add(1, std::memory_order_relaxed);
+		};
+
+
+		/** \brief Remove a key, locking only the key's shard
+		 * @param key Key
+		 * @return True if the key was in the map
+		 */
+		bool Remove(const K &key) {
+			uint64_t hash = Get_Hash(key);
+			Shard &shard = Get_Shard(hash);
+			std::lock_guard<std::mutex> lock(shard._Lock);
+			Table *table = shard._Table.load(std::memory_order_relaxed);
+
+			Begin_Write(shard);
+			bool removed = table->Remove(hash, key, _Eq);
+			End_Write(shard);
+			if (removed) {
+				_NumKeys.fetch_sub(1, std::memory_order_relaxed);
+			}
+			return removed;
+		};
+
+
+		/** \brief Copy out every entry as of a single moment
+		 *
+		 * All shards are locked while copying so the snapshot is consistent across shards; writers wait for it,
+		 * readers do not.
+		 * @param out Receives the entries
+		 */
+		void Take_Snapshot(std::vector<std::pair<K, V>> &out) const {
+			out.clear();
+			for (unsigned int i = 0; i < _NumShards; i++) {
+				_Shards[i]._Lock.lock();
+			}
+			out.reserve(_NumKeys.load(std::memory_order_relaxed));
+			for (unsigned int i = 0; i < _NumShards; i++) {
+				Table *table = _Shards[i]._Table.load(std::memory_order_relaxed);
+				Slot slot;
+				for (unsigned int j = 0; j < table->_Capacity; j++) {
+					if (table->Get_SlotHash(j)) {
+						table->Load_Slot(j, slot);
+						out.push_back(std::pair<K, V>(slot._Key, slot._Val));
+					}
+				}
+			}
+			for (unsigned int i = _NumShards; i > 0; i--) {
+				_Shards[i - 1]._Lock.unlock();
+			}
+		};
+
+
+		/** \brief Call a function for every entry of a snapshot of the map
+		 * @param func Function taking (const K &, const V &)
+		 */
+		template <typename Func>
+		void For_Each(Func func) const {
+			std::vector<std::pair<K, V>> snapshot;
+			Take_Snapshot(snapshot);
+			for (size_t i = 0; i < snapshot.size(); i++) {
+				func(snapshot[i].first, snapshot[i].second);
+			}
+		};
+
+
+		unsigned int Get_NumKeys(void) const { return _NumKeys.load(std::memory_order_relaxed); };
+		unsigned int Get_NumShards(void) const { return _NumShards; };
+
+		private:
+		PConcurrentHashMap(const PConcurrentHashMap &);
+		PConcurrentHashMap &operator=(const PConcurrentHashMap &);
+
+		// a slot is empty while its hash is 0, real hashes of 0 are stored as 1
+		struct Slot {
+			uint64_t _Hash;
+			K _Key;
+			V _Val;
+		};
+
+
+		// linear probing table of one shard
+		//   slots are kept as relaxed atomic words so a reader copying one while a writer changes it doesn't race,
+		//   the shard's sequence counter then tells the reader whether its copy can be trusted
+		struct Table {
+			enum { SlotWords = (sizeof(Slot) + sizeof(uint64_t) - 1) / sizeof(uint64_t) };
+
+			std::atomic<uint64_t> *_Words;
+			unsigned int _Capacity;
+			unsigned int _NumKeys;
+
+			Table(unsigned int capacity) : _Capacity(capacity), _NumKeys(0) {
+				_Words = new std::atomic<uint64_t>[(size_t)capacity * SlotWords];
+				for (size_t i = 0; i < (size_t)capacity * SlotWords; i++) {
+					_Words[i].store(0, std::memory_order_relaxed);
+				}
+			};
+
+			~Table(void) { delete[]_Words; };
+
+			// the hash is the slot's first word
+			uint64_t Get_SlotHash(unsigned int idx) const {
+				return _Words[(size_t)idx * SlotWords].load(std::memory_order_relaxed);
+			};
+
+			void Load_Slot(unsigned int idx, Slot &slot) const {
+				uint64_t words[SlotWords];
+				for (unsigned int w = 0; w < SlotWords; w++) {
+					words[w] = _Words[(size_t)idx * SlotWords + w].load(std::memory_order_relaxed);
+				}
+				memcpy(&slot, words, sizeof(Slot));
+			};
+
+			void Store_Slot(unsigned int idx, const Slot &slot) {
+				uint64_t words[SlotWords] = {};
+				memcpy(words, &slot, sizeof(Slot));
+				for (unsigned int w = 0; w < SlotWords; w++) {
+					_Words[(size_t)idx * SlotWords + w].store(words[w], std::memory_order_relaxed);
+				}
+			};
+
+			// probing is bounded by the capacity so a reader seeing a half written table still stops
+			bool Find(uint64_t hash, const K &key, const Eq &eq, Slot &found) const {
+				unsigned int mask = _Capacity - 1;
+				unsigned int idx = (unsigned int)hash & mask;
+				for (unsigned int n = 0; n < _Capacity; n++, idx = (idx + 1) & mask) {
+					uint64_t slotHash = Get_SlotHash(idx);
+					if (!slotHash) {
+						return false;
+					}
+					if (slotHash == hash) {
+						Load_Slot(idx, found);
+						if (eq(found._Key, key)) {
+							return true;
+						}
+					}
+				}
+				return false;
+			};
+
+			bool Replace(const Slot &slot, const Eq &eq) {
+				unsigned int mask = _Capacity - 1;
+				Slot cur;
+				for (unsigned int idx = (unsigned int)slot._Hash & mask; Get_SlotHash(idx); idx = (idx + 1) & mask) {
+					if (Get_SlotHash(idx) != slot._Hash) {
+						continue;
+					}
+					Load_Slot(idx, cur);
+					if (eq(cur._Key, slot._Key)) {
+						Store_Slot(idx, slot);
+						return true;
+					}
+				}
+				return false;
+			};
+
+			void Insert(const Slot &slot) {
+				unsigned int mask = _Capacity - 1;
+				unsigned int idx = (unsigned int)slot._Hash & mask;
+				while (Get_SlotHash(idx)) {
+					idx = (idx + 1) & mask;
+				}
+				Store_Slot(idx, slot);
+				_NumKeys++;
+			};
+
+			// remove by shifting the rest of the probe run back, leaving no tombstones
+			bool Remove(uint64_t hash, const K &key, const Eq &eq) {
+				unsigned int mask = _Capacity - 1;
+				unsigned int idx = (unsigned int)hash & mask;
+				Slot cur;
+				for (;; idx = (idx + 1) & mask) {
+					uint64_t slotHash = Get_SlotHash(idx);
+					if (!slotHash) {
+						return false;
+					}
+					if (slotHash == hash) {
+						Load_Slot(idx, cur);
+						if (eq(cur._Key, key)) {
+							break;
+						}
+					}
+				}
+
+				for (unsigned int next = (idx + 1) & mask; Get_SlotHash(next); next = (next + 1) & mask) {
+					unsigned int home = (unsigned int)Get_SlotHash(next) & mask;
+					if (((next - home) & mask) >= ((next - idx) & mask)) {
+						Load_Slot(next, cur);
+						Store_Slot(idx, cur);
+						idx = next;
+					}
+				}
+				_Words[(size_t)idx * SlotWords].store(0, std::memory_order_relaxed);
+				_NumKeys--;
+				return true;
+			};
+		};
+
+
+		// shards sit on their own cache lines so writers to one don't slow readers of its neighbours
+		struct alignas(PSTD_CACHELINE_SIZE) Shard {
+			std::atomic<uint32_t> _Seq;						// Odd while a writer is changing the shard
+			std::atomic<Table *> _Table;
+			mutable std::mutex _Lock;						// Held by writers
+			std::vector<Table *> _Retired;					// Tables replaced by growth, freed with the map
+
+			Shard(void) : _Seq(0), _Table(NULL) {};
+		};
+
+
+		uint64_t Get_Hash(const K &key) const {
+			uint64_t hash = _Hash(key);
+			return (hash) ? hash : 1;
+		};
+
+		// the top bits pick the shard, the low bits the slot within it
+		Shard &Get_Shard(uint64_t hash) const { return _Shards[(_ShardBits) ? (size_t)(hash >> (64 - _ShardBits)) : 0]; };
+
+		static void Begin_Write(Shard &shard) {
+			shard._Seq.store(shard._Seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		};
+
+		static void End_Write(Shard &shard) {
+			shard._Seq.store(shard._Seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		};
+
+		static void Backoff(unsigned int &spins) {
+			if (++spins >= PCHM_SPIN_COUNT) {
+				spins = 0;
+				std::this_thread::yield();
+			}
+		};
+
+
+		Shard *_Shards;								// Cache line aligned within _ShardMem
+		char *_ShardMem;
+		unsigned int _NumShards;
+		unsigned int _ShardBits;
+		std::atomic<unsigned int> _NumKeys;
+		Hash _Hash;
+		Eq _Eq;
+	};
+
+}
+
+#endif
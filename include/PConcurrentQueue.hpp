@@ -0,0 +1,306 @@
+/** \file PConcurrentQueue.hpp
+ *  \brief Lock free queues for passing work between threads
+ *
+ * PMPSCQueue is an unbounded multi producer / single consumer queue (Vyukov's node based design) whose links
+ * live in nodes taken from a thread safe pool, and PSPSCRing is a bounded single producer / single consumer ring
+ * buffer.  Both offer batch dequeues so a consumer can drain many items per wake up.
+ */
+
+#ifndef PCONCURRENTQUEUE_H
+#define PCONCURRENTQUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "PooledMemManagerLF.hpp"
+#include "PCacheLine.hpp"
+
+namespace PSTD {
+
+
+	/** \brief Node of a PMPSCQueue, the element is constructed and destroyed by the queue */
+	template <typename T>
+	struct PQueueNode {
+		std::atomic<PQueueNode *> _Next;
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type _Data;
+
+		PQueueNode(void) : _Next(NULL) {};
+
+		T *Get_Data(void) { return reinterpret_cast<T *>(&_Data); };
+	};
+
+
+	/** \brief Unbounded multi producer / single consumer queue
+	 *
+	 * Enqueue is wait free: a producer swaps its node in as the new head and then links the old head to it.  While
+	 * a producer is between those two steps the consumer sees the queue as ending at the unlinked node, so a
+	 * dequeue may report empty even though an enqueue is under way; it will be seen on a later call.  The queue
+	 * always holds one stub node whose element has already been consumed.
+	 * \tparam T Type of the queued elements
+	 * \tparam NodePool Pool the nodes come from, must allow allocation from many threads (PoolMemManagerLF or
+	 *                  PoolMemManagerTC)
+	 */
+	template <typename T, typename NodePool = PoolMemManagerLF<PQueueNode<T>>>
+	class PMPSCQueue {
+		public:
+		typedef PQueueNode<T> Node;
+
+		/** \brief Constructor for a queue with a pool of its own
+		 * @param poolSize Number of nodes in each block of the queue's pool, which grows as needed
+		 */
+		PMPSCQueue(unsigned int poolSize) :
+			_MemManager(new NodePool(poolSize, true)),
+			_Pool(_MemManager)
+		{
+			Init_Queue();
+		};
+
+		/** \brief Constructor for a queue borrowing a pool owned elsewhere, which must outlive it
+		 * @param pool Pool to allocate nodes from
+		 */
+		explicit PMPSCQueue(NodePool *pool) :
+			_MemManager(NULL),
+			_Pool(pool)
+		{
+			Init_Queue();
+		};
+
+		//! Deconstructor, must not run while producers are still enqueuing
+		~PMPSCQueue(void) {
+			Node *node = _Tail->_Next.load(std::memory_order_acquire);
+			_Pool->Free_Object(_Tail);
+			while (node) {
+				Node *next = node->_Next.load(std::memory_order_acquire);
+				node->Get_Data()->~T();
+				_Pool->Free_Object(node);
+				node = next;
+			}
+			delete _MemManager;
+		};
+
+
+		/** \brief Add an element to the queue, may be called concurrently from any number of threads
+		 * @param value Element to add
+		 * @return False if no node could be allocated
+		 */
+		bool Enqueue(T value) {
+			Node *node = _Pool->Allocate_Object();
+			if (!node) {
+				return false;
+			}
+			new (node->Get_Data()) T(std::move(value));
+			node->_Next.store(NULL, std::memory_order_relaxed);
+
+			Node *prev = _Head.exchange(node, std::memory_order_acq_rel);
+			prev->_Next.store(node, std::memory_order_release);
+			return true;
+		};
+
+
+		/** \brief Take the oldest element off the queue, only the consumer thread may call this
+		 * @param value Receives the element
+		 * @return False if the queue was empty
+		 */
+		bool Try_Dequeue(T &value) {
+			Node *tail = _Tail;
+			Node *next = tail->_Next.load(std::memory_order_acquire);
+			if (!next) {
+				return false;
+			}
+
+			// the next node becomes the stub once its element is taken
+			value = std::move(*next->Get_Data());
+			next->Get_Data()->~T();
+			_Tail = next;
+			_Pool->Free_Object(tail);
+			return true;
+		};
+
+
+		/** \brief Take up to maxCnt of the oldest elements off the queue, only the consumer thread may call this
+		 * @param out Array receiving the elements
+		 * @param maxCnt Size of the array
+		 * @return Number of elements taken
+		 */
+		size_t Dequeue_Batch(T *out, size_t maxCnt) {
+			size_t cnt = 0;
+			Node *tail = _Tail;
+
+			while (cnt < maxCnt) {
+				Node *next = tail->_Next.load(std::memory_order_acquire);
+				if (!next) {
+					break;
+				}
+				out[cnt++] = std::move(*next->Get_Data());
+				next->Get_Data()->~T();
+				_Pool->Free_Object(tail);
+				tail = next;
+			}
+			_Tail = tail;
+			return cnt;
+		};
+
+
+		/** \brief Check if the queue holds no fully linked elements, only meaningful on the consumer thread */
+		bool Is_Empty(void) { return _Tail->_Next.load(std::memory_order_acquire) == NULL; };
+
+		private:
+		PMPSCQueue(const PMPSCQueue &);
+		PMPSCQueue &operator=(const PMPSCQueue &);
+
+		void Init_Queue(void) {
+			Node *stub = _Pool->Allocate_Object();
+			stub->_Next.store(NULL, std::memory_order_relaxed);
+			_Head.store(stub, std::memory_order_relaxed);
+			_Tail = stub;
+		};
+
+
+		NodePool *_MemManager;							// Pool owned by the queue, NULL when it borrows one
+		NodePool *_Pool;								// Pool nodes are allocated from
+		alignas(PSTD_CACHELINE_SIZE) std::atomic<Node *> _Head;	// Most recently enqueued node, swapped by producers
+		alignas(PSTD_CACHELINE_SIZE) Node *_Tail;				// Stub node in front of the oldest element, consumer only
+	};
+
+
+	/** \brief Bounded single producer / single consumer ring buffer
+	 *
+	 * Each side keeps a cached copy of the other side's index and only reloads it when the ring looks full (or
+	 * empty), so in steady state the producer and consumer don't touch each other's cache lines.  Elements are
+	 * stored in the ring itself, for large objects queue pointers to pooled objects instead.  The two sides are
+	 * aligned to PSTD_CACHELINE_SIZE, which a heap allocated ring only gets with C++17 aligned new.
+	 * \tparam T Type of the queued elements
+	 */
+	template <typename T>
+	class PSPSCRing {
+		public:
+
+		/** \brief Constructor
+		 * @param capacity Minimum number of elements the ring can hold, rounded up to a power of two
+		 */
+		PSPSCRing(unsigned int capacity) :
+			_ReadIndex(0),
+			_CachedWrite(0),
+			_WriteIndex(0),
+			_CachedRead(0)
+		{
+			_Capacity = 1;
+			while (_Capacity < capacity) {
+				_Capacity <<= 1;
+			}
+			_Mask = _Capacity - 1;
+			_Slots = new Slot[_Capacity];
+		};
+
+		~PSPSCRing(void) {
+			size_t write = _WriteIndex.load(std::memory_order_acquire);
+			for (size_t read = _ReadIndex.load(std::memory_order_relaxed); read != write; read++) {
+				Get_Slot(read)->~T();
+			}
+			delete[]_Slots;
+		};
+
+
+		/** \brief Add an element to the ring, only the producer thread may call this
+		 * @param value Element to add
+		 * @return False if the ring is full
+		 */
+		bool Try_Enqueue(const T &value) { return Emplace(value); };
+		bool Try_Enqueue(T &&value) { return Emplace(std::move(value)); };
+
+
+		/** \brief Take the oldest element out of the ring, only the consumer thread may call this
+		 * @param value Receives the element
+		 * @return False if the ring is empty
+		 */
+		bool Try_Dequeue(T &value) {
+			size_t read = _ReadIndex.load(std::memory_order_relaxed);
+			if (read == _CachedWrite) {
+				_CachedWrite = _WriteIndex.load(std::memory_order_acquire);
+				if (read == _CachedWrite) {
+					return false;
+				}
+			}
+
+			T *slot = Get_Slot(read);
+			value = std::move(*slot);
+			slot->~T();
+			_ReadIndex.store(read + 1, std::memory_order_release);
+			return true;
+		};
+
+
+		/** \brief Take up to maxCnt of the oldest elements out of the ring, only the consumer thread may call this
+		 * @param out Array receiving the elements
+		 * @param maxCnt Size of the array
+		 * @return Number of elements taken
+		 */
+		size_t Dequeue_Batch(T *out, size_t maxCnt) {
+			size_t read = _ReadIndex.load(std::memory_order_relaxed);
+			if (_CachedWrite - read < maxCnt) {
+				_CachedWrite = _WriteIndex.load(std::memory_order_acquire);
+			}
+
+			size_t cnt = _CachedWrite - read;
+			if (cnt > maxCnt) {
+				cnt = maxCnt;
+			}
+			for (size_t i = 0; i < cnt; i++) {
+				T *slot = Get_Slot(read + i);
+				out[i] = std::move(*slot);
+				slot->~T();
+			}
+
+			// hand all the slots back to the producer at once
+			_ReadIndex.store(read + cnt, std::memory_order_release);
+			return cnt;
+		};
+
+
+		/** \brief Get the number of elements in the ring, exact only when called from one of its two threads */
+		size_t Get_Size(void) { return _WriteIndex.load(std::memory_order_acquire) - _ReadIndex.load(std::memory_order_acquire); };
+
+		size_t Get_Capacity(void) { return _Capacity; };
+
+		private:
+		PSPSCRing(const PSPSCRing &);
+		PSPSCRing &operator=(const PSPSCRing &);
+
+		typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type Slot;
+
+		T *Get_Slot(size_t index) { return reinterpret_cast<T *>(&_Slots[index & _Mask]); };
+
+		template <typename U>
+		bool Emplace(U &&value) {
+			size_t write = _WriteIndex.load(std::memory_order_relaxed);
+			if (write - _CachedRead == _Capacity) {
+				_CachedRead = _ReadIndex.load(std::memory_order_acquire);
+				if (write - _CachedRead == _Capacity) {
+					return false;
+				}
+			}
+
+			new (Get_Slot(write)) T(std::forward<U>(value));
+			_WriteIndex.store(write + 1, std::memory_order_release);
+			return true;
+		};
+
+
+		Slot *_Slots;
+		size_t _Capacity;
+		size_t _Mask;
+
+		// consumer side, each side starts its own cache line and the class size rounds up to whole lines
+		alignas(PSTD_CACHELINE_SIZE) std::atomic<size_t> _ReadIndex;	// Next slot to read
+		size_t _CachedWrite;											// Last seen value of _WriteIndex
+
+		// producer side
+		alignas(PSTD_CACHELINE_SIZE) std::atomic<size_t> _WriteIndex;	// Next slot to write
+		size_t _CachedRead;												// Last seen value of _ReadIndex
+	};
+
+}
+
+#endif
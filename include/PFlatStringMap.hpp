@@ -0,0 +1,196 @@
+/** \file PFlatStringMap.hpp
+ *  \brief Open addressing string keyed hash map
+ *
+ * A flat replacement for PHashTable built on PFlatTable, so a lookup compares 16 control bytes at once to find
+ * candidate slots.  Each slot also keeps its full hash and the key's length, so almost every mismatch is rejected
+ * without touching the key.  Keys are copied into an arena owned by the map.
+ */
+
+#pragma once
+
+#ifndef PFLATSTRINGMAP_H
+#define PFLATSTRINGMAP_H
+
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include "PArena.hpp"
+#include "PFlatTable.hpp"
+
+
+#define FSM_KEY_BLOCK_SIZE	(16 * 1024)		// arena block size for key storage
+
+namespace PSTD {
+
+
+	/** \brief String keyed hash map using open addressing with linear group probing
+	 *
+	 * Deletion shifts the following entries of the probe run back instead of leaving tombstones, so lookups never
+	 * get slower from churn.  The table doubles when it passes 7/8 full.  Key memory freed by deletions is
+	 * reclaimed when the table is rebuilt, which also happens once dead keys outweigh live ones.
+	 * \tparam T Type of the values
+	 */
+	template <typename T>
+	class PFlatStringMap {
+		public:
+
+		/** \brief Constructor
+		 * @param initialSize Number of keys the map should hold before it has to grow
+		 */
+		PFlatStringMap(unsigned int initialSize = PFT_MIN_CAPACITY) :
+			_Table(initialSize),
+			_LiveKeyBytes(0),
+			_DeadKeyBytes(0),
+			_Keys(new PArena(FSM_KEY_BLOCK_SIZE))
+		{
+		};
+
+		~PFlatStringMap(void) { delete _Keys; };
+
+
+		/** \brief Add a key or replace the value of an existing one
+		 * @param key Null terminated key, copied into the map
+		 * @param val Value to store
+		 */
+		void Set(const char *key, T val) {
+			uint32_t len;
+			uint64_t hash = Hash_Key(key, len);
+			Slot *slot = Find_Slot(key, len, hash);
+
+			if (slot) {
+				slot->_Val = std::move(val);
+				return;
+			}
+
+			if (_Table.Is_Full()) {
+				Rebuild(_Table.Get_Capacity() * 2);
+			}
+			new (_Table.Insert(hash)) Slot(hash, _Keys->Copy_String(key, len), len, std::move(val));
+			_LiveKeyBytes += len + 1;
+		};
+
+
+		/** \brief Look up a key
+		 * @param key Null terminated key
+		 * @param val Receives the value if the key is found
+		 * @return True if the key was found
+		 */
+		bool Get(const char *key, T &val) const {
+			const T *found = Find(key);
+			if (!found) {
+				return false;
+			}
+			val = *found;
+			return true;
+		};
+
+
+		/** \brief Look up a key
+		 * @param key Null terminated key
+		 * @return Pointer to the key's value, NULL if the key is not in the map
+		 */
+		T *Find(const char *key) {
+			uint32_t len;
+			uint64_t hash = Hash_Key(key, len);
+			Slot *slot = Find_Slot(key, len, hash);
+			return (slot) ? &slot->_Val : NULL;
+		};
+
+		const T *Find(const char *key) const { return const_cast<PFlatStringMap<T> *>(this)->Find(key); };
+
+
+		/** \brief Remove a key
+		 * @param key Null terminated key
+		 * @return True if the key was in the map
+		 */
+		bool Remove(const char *key) {
+			uint32_t len;
+			uint64_t hash = Hash_Key(key, len);
+			Slot *slot = Find_Slot(key, len, hash);
+
+			if (!slot) {
+				return false;
+			}
+			_Table.Remove(slot);
+
+			_LiveKeyBytes -= len + 1;
+			_DeadKeyBytes += len + 1;
+			if ((_DeadKeyBytes > _LiveKeyBytes) && (_DeadKeyBytes > FSM_KEY_BLOCK_SIZE)) {
+				Rebuild(_Table.Get_Capacity());
+			}
+			return true;
+		};
+
+
+		/** \brief Make room for a number of keys without further growth
+		 * @param numKeys Number of keys
+		 */
+		void Reserve(unsigned int numKeys) { _Table.Reserve(numKeys); };
+
+
+		/** \brief Remove every key */
+		void Clear(void) {
+			_Table.Clear();
+			_Keys->Reset();
+			_LiveKeyBytes = _DeadKeyBytes = 0;
+		};
+
+
+		unsigned int Get_NumKeys(void) const { return _Table.Get_NumKeys(); };
+		unsigned int Get_Capacity(void) const { return _Table.Get_Capacity(); };
+
+		private:
+		PFlatStringMap(const PFlatStringMap &);
+		PFlatStringMap &operator=(const PFlatStringMap &);
+
+		struct Slot {
+			uint64_t _Hash;
+			const char *_Key;
+			uint32_t _KeyLen;
+			T _Val;
+
+			Slot(uint64_t hash, const char *key, uint32_t keyLen, T &&val) : _Hash(hash), _Key(key), _KeyLen(keyLen), _Val(std::move(val)) {};
+		};
+
+
+		// 64 bit FNV-1a, measuring the key's length on the way
+		static uint64_t Hash_Key(const char *key, uint32_t &len) {
+			uint64_t hash = 14695981039346656037ULL;
+			const char *s = key;
+			for (; *s; s++) {
+				hash = (hash ^ (unsigned char)*s) * 1099511628211ULL;
+			}
+			len = (uint32_t)(s - key);
+			return hash;
+		};
+
+
+		Slot *Find_Slot(const char *key, uint32_t len, uint64_t hash) const {
+			return _Table.Find(hash, [&](const Slot &slot) { return (slot._KeyLen == len) && !memcmp(slot._Key, key, len); });
+		};
+
+
+		// move every entry into a new table of the given capacity, compacting the key storage
+		void Rebuild(unsigned int capacity) {
+			PArena *oldKeys = _Keys;
+			PArena *keys = new PArena(FSM_KEY_BLOCK_SIZE);
+
+			_Table.Rehash(capacity, [keys](Slot &from, void *to) {
+				new (to) Slot(from._Hash, keys->Copy_String(from._Key, from._KeyLen), from._KeyLen, std::move(from._Val));
+			});
+
+			_Keys = keys;
+			_DeadKeyBytes = 0;
+			delete oldKeys;
+		};
+
+
+		PFlatTable<Slot> _Table;
+		size_t _LiveKeyBytes;						// Key storage used by keys in the map
+		size_t _DeadKeyBytes;						// Key storage left behind by removed keys
+		PArena *_Keys;								// Storage for the key strings
+	};
+
+}
+
+#endif
@@ -0,0 +1,313 @@
+/** \file PFlatTable.hpp
+ *  \brief Open addressing table core shared by PHashMap and PFlatStringMap
+ *
+ * Slots sit in one array next to an array of one byte control words holding 7 bits of each slot's hash (or
+ * marking it empty), in the style of Swiss tables.  A probe compares 16 control bytes at once to find candidate
+ * slots, and removal shifts the rest of the probe run back instead of leaving tombstones.  The maps on top decide
+ * what a slot holds and how keys are compared.
+ */
+
+#pragma once
+
+#ifndef PFLATTABLE_H
+#define PFLATTABLE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE_AVAIL__
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+#define PFT_GROUP_SIZE		16				// control bytes compared per probe step
+#define PFT_CTRL_EMPTY		0x80			// control byte of an empty slot, full slots hold 7 bits of hash
+#define PFT_MIN_CAPACITY	16
+
+namespace PSTD {
+
+
+	/** \brief Open addressing table with linear group probing
+	 *
+	 * The table doubles when it passes 7/8 full.  Slots are constructed and destroyed in place, and moved with
+	 * their move constructor when the table is rebuilt.
+	 * \tparam Slot Type of the slots, which must have a uint64_t _Hash member holding the key's full hash
+	 */
+	template <typename Slot>
+	class PFlatTable {
+		public:
+
+		/** \brief Constructor
+		 * @param initialSize Number of slots the table should fill before it has to grow
+		 */
+		PFlatTable(unsigned int initialSize = PFT_MIN_CAPACITY) :
+			_Slots(NULL),
+			_Ctrl(NULL),
+			_Capacity(0),
+			_NumKeys(0)
+		{
+			Rehash(Get_CapacityFor(initialSize));
+		};
+
+		~PFlatTable(void) {
+			Destroy_Slots();
+			delete[]_Slots;
+			delete[]_Ctrl;
+		};
+
+
+		/** \brief Look for a slot
+		 * @param hash Full hash of the key
+		 * @param match Functor taking (const Slot &) and returning true for the wanted slot, only called on slots
+		 *              with an equal hash
+		 * @return The slot, NULL if there is none
+		 */
+		template <typename Match>
+		Slot *Find(uint64_t hash, Match match) const {
+			size_t mask = _Capacity - 1;
+			size_t pos = Get_H1(hash) & mask;
+			unsigned char h2 = Get_H2(hash);
+
+			for (;;) {
+				uint32_t found = Match_Group(pos, h2);
+				while (found) {
+					Slot *slot = Get_Slot((pos + Get_LowestBit(found)) & mask);
+					if ((slot->_Hash == hash) && match(*slot)) {
+						return slot;
+					}
+					found &= found - 1;
+				}
+
+				// an empty slot ends the probe run
+				if (Match_Empty(pos)) {
+					return NULL;
+				}
+				pos = (pos + PFT_GROUP_SIZE) & mask;
+			}
+		};
+
+
+		/** \brief Claim an empty slot for a new key, growing the table first if it is full
+		 * @param hash Full hash of the key, which must not be in the table yet
+		 * @return Storage for the slot, which the caller constructs in place
+		 */
+		void *Insert(uint64_t hash) {
+			if (Is_Full()) {
+				Rehash(_Capacity * 2);
+			}
+
+			size_t idx = Find_EmptySlot(hash);
+			Set_Ctrl(idx, Get_H2(hash));
+			_NumKeys++;
+			return &_Slots[idx];
+		};
+
+
+		/** \brief Destroy a slot and pull back any following entry of its probe run which may live in the hole
+		 * @param slot Slot returned by Find
+		 */
+		void Remove(Slot *slot) {
+			size_t mask = _Capacity - 1;
+			size_t idx = (size_t)(reinterpret_cast<SlotStorage *>(slot) - _Slots);
+			slot->~Slot();
+
+			size_t next = idx;
+			for (;;) {
+				next = (next + 1) & mask;
+				if (_Ctrl[next] == PFT_CTRL_EMPTY) {
+					break;
+				}
+
+				size_t home = Get_H1(Get_Slot(next)->_Hash) & mask;
+				if (((next - home) & mask) >= ((next - idx) & mask)) {
+					new (Get_Slot(idx)) Slot(std::move(*Get_Slot(next)));
+					Get_Slot(next)->~Slot();
+					Set_Ctrl(idx, _Ctrl[next]);
+					idx = next;
+				}
+			}
+			Set_Ctrl(idx, PFT_CTRL_EMPTY);
+			_NumKeys--;
+		};
+
+
+		/** \brief Move every slot into a new table
+		 * @param capacity Number of slots, a power of two
+		 */
+		void Rehash(unsigned int capacity) {
+			Rehash(capacity, [](Slot &from, void *to) { new (to) Slot(std::move(from)); });
+		};
+
+		/** \brief Move every slot into a new table
+		 * @param capacity Number of slots, a power of two
+		 * @param relocate Functor taking (Slot &from, void *to) which constructs the new slot at to, the old one
+		 *                 is destroyed afterwards
+		 */
+		template <typename Relocate>
+		void Rehash(unsigned int capacity, Relocate relocate) {
+			SlotStorage *oldSlots = _Slots;
+			unsigned char *oldCtrl = _Ctrl;
+			unsigned int oldCapacity = _Capacity;
+
+			_Slots = new SlotStorage[capacity];
+			_Ctrl = new unsigned char[capacity + PFT_GROUP_SIZE];
+			memset(_Ctrl, PFT_CTRL_EMPTY, capacity + PFT_GROUP_SIZE);
+			_Capacity = capacity;
+
+			for (size_t i = 0; i < oldCapacity; i++) {
+				if (oldCtrl[i] != PFT_CTRL_EMPTY) {
+					Slot *slot = reinterpret_cast<Slot *>(&oldSlots[i]);
+					size_t idx = Find_EmptySlot(slot->_Hash);
+					relocate(*slot, &_Slots[idx]);
+					Set_Ctrl(idx, oldCtrl[i]);
+					slot->~Slot();
+				}
+			}
+
+			delete[]oldSlots;
+			delete[]oldCtrl;
+		};
+
+
+		/** \brief Make room for a number of keys without further growth
+		 * @param numKeys Number of keys
+		 */
+		void Reserve(unsigned int numKeys) {
+			unsigned int capacity = Get_CapacityFor(numKeys);
+			if (capacity > _Capacity) {
+				Rehash(capacity);
+			}
+		};
+
+
+		/** \brief Destroy every slot */
+		void Clear(void) {
+			Destroy_Slots();
+			memset(_Ctrl, PFT_CTRL_EMPTY, _Capacity + PFT_GROUP_SIZE);
+			_NumKeys = 0;
+		};
+
+
+		/** \brief Call a function for every slot in table order
+		 * @param func Function taking (Slot &)
+		 */
+		template <typename Func>
+		void For_Each(Func func) const {
+			for (size_t i = 0; i < _Capacity; i++) {
+				if (_Ctrl[i] != PFT_CTRL_EMPTY) {
+					func(*Get_Slot(i));
+				}
+			}
+		};
+
+
+		bool Is_Full(void) const { return (size_t)(_NumKeys + 1) * 8 > (size_t)_Capacity * 7; };
+		unsigned int Get_NumKeys(void) const { return _NumKeys; };
+		unsigned int Get_Capacity(void) const { return _Capacity; };
+
+		private:
+		PFlatTable(const PFlatTable &);
+		PFlatTable &operator=(const PFlatTable &);
+
+		typedef typename std::aligned_storage<sizeof(Slot), std::alignment_of<Slot>::value>::type SlotStorage;
+
+
+		// the low 7 bits go in the control byte, the rest pick the home slot
+		static size_t Get_H1(uint64_t hash) { return (size_t)(hash >> 7); };
+		static unsigned char Get_H2(uint64_t hash) { return (unsigned char)(hash & 0x7F); };
+
+		static unsigned int Get_CapacityFor(unsigned int numKeys) {
+			unsigned int capacity = PFT_MIN_CAPACITY;
+			while ((size_t)capacity * 7 < (size_t)numKeys * 8) {
+				capacity <<= 1;
+			}
+			return capacity;
+		};
+
+		static unsigned int Get_LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+			unsigned long idx;
+			_BitScanForward(&idx, mask);
+			return idx;
+#else
+			return __builtin_ctz(mask);
+#endif
+		};
+
+
+		// bit i set where control byte i of the group at pos equals h2
+		uint32_t Match_Group(size_t pos, unsigned char h2) const {
+#ifdef __SSE_AVAIL__
+			__m128i ctrl = _mm_loadu_si128((const __m128i *)(_Ctrl + pos));
+			return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+#else
+			uint32_t mask = 0;
+			for (unsigned int i = 0; i < PFT_GROUP_SIZE; i++) {
+				mask |= (uint32_t)(_Ctrl[pos + i] == h2) << i;
+			}
+			return mask;
+#endif
+		};
+
+		// bit i set where slot i of the group at pos is empty
+		uint32_t Match_Empty(size_t pos) const {
+#ifdef __SSE_AVAIL__
+			return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(_Ctrl + pos)));
+#else
+			uint32_t mask = 0;
+			for (unsigned int i = 0; i < PFT_GROUP_SIZE; i++) {
+				mask |= (uint32_t)(_Ctrl[pos + i] >> 7) << i;
+			}
+			return mask;
+#endif
+		};
+
+
+		size_t Find_EmptySlot(uint64_t hash) const {
+			size_t mask = _Capacity - 1;
+			size_t pos = Get_H1(hash) & mask;
+
+			for (;;) {
+				uint32_t empty = Match_Empty(pos);
+				if (empty) {
+					return (pos + Get_LowestBit(empty)) & mask;
+				}
+				pos = (pos + PFT_GROUP_SIZE) & mask;
+			}
+		};
+
+
+		// the first group's worth of control bytes is mirrored past the end so groups can be loaded across the wrap
+		void Set_Ctrl(size_t idx, unsigned char ctrl) {
+			_Ctrl[idx] = ctrl;
+			if (idx < PFT_GROUP_SIZE) {
+				_Ctrl[_Capacity + idx] = ctrl;
+			}
+		};
+
+		Slot *Get_Slot(size_t idx) const { return reinterpret_cast<Slot *>(&_Slots[idx]); };
+
+		void Destroy_Slots(void) {
+			for (size_t i = 0; i < _Capacity; i++) {
+				if (_Ctrl[i] != PFT_CTRL_EMPTY) {
+					Get_Slot(i)->~Slot();
+				}
+			}
+		};
+
+
+		SlotStorage *_Slots;						// Entries, valid where the control byte is not empty
+		unsigned char *_Ctrl;						// Control bytes, _Capacity plus a mirrored group
+		unsigned int _Capacity;						// Number of slots, a power of two
+		unsigned int _NumKeys;
+	};
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+/** \file PHashFunctions.hpp
+ *  \brief Hash functions and hashing policies for the PSTD hash containers
+ *
+ * Byte hashes (FNV-1a, a wyhash style multiply-fold hash, an xxh3 style striped hash and CRC32C) plus functors
+ * applying them to keys.  A container picks its hash at compile time through its Hash template parameter, and
+ * PHashDefault maps integers and pointers to a single multiply mix so they never go through a byte hash.
+ */
+
+#pragma once
+
+#ifndef PHASHFUNCTIONS_H
+#define PHASHFUNCTIONS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<string_view>) && ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#include <string_view>
+#define PHASH_HAS_STRING_VIEW
+#endif
+#endif
+
+// CRC32C uses the SSE4.2 crc32 instruction when the compiler targets it
+#if defined(__SSE_AVAIL__) && (defined(__SSE4_2__) || defined(__AVX__))
+#include <nmmintrin.h>
+#define PHASH_HAS_SSE42
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+#define PHASH_WY_P0		0xa0761d6478bd642fULL
+#define PHASH_WY_P1		0xe7037ed1a0b428dbULL
+#define PHASH_WY_P2		0x8ebc6af09c88c6e3ULL
+#define PHASH_XXH_P1	0x9E3779B185EBCA87ULL
+#define PHASH_XXH_P2	0xC2B2AE3D27D4EB4FULL
+#define PHASH_XXH_P3	0x165667B19E3779F9ULL
+#define PHASH_CRC32C_POLY	0x82F63B78		// Castagnoli polynomial, reflected
+
+namespace PSTD {
+	namespace PHash {
+
+
+		inline uint64_t Read64(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; };
+		inline uint64_t Read32(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; };
+
+		// the upper and lower halves of the 128 bit product of a and b folded together
+		inline uint64_t Mul_Fold(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+			__uint128_t r = (__uint128_t)a * b;
+			return (uint64_t)r ^ (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			uint64_t hi;
+			uint64_t lo = _umul128(a, b, &hi);
+			return lo ^ hi;
+#else
+			uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+			uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+			uint64_t t = rl + (rm0 << 32);
+			uint64_t lo = t + (rm1 << 32);
+			uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+			return lo ^ hi;
+#endif
+		};
+
+
+		/** \brief Mix the bits of a 64 bit integer, for integer and pointer keys
+		 * @param x Value to mix
+		 * @return Hash
+		 */
+		inline uint64_t Mix64(uint64_t x) {
+			return Mul_Fold(x ^ PHASH_WY_P0, PHASH_WY_P1);
+		};
+
+
+		/** \brief 64 bit FNV-1a
+		 * @param data Bytes to hash
+		 * @param len Number of bytes
+		 * @return Hash
+		 */
+		inline uint64_t FNV1a(const void *data, size_t len) {
+			const unsigned char *p = (const unsigned char *)data;
+			uint64_t hash = 14695981039346656037ULL;
+			for (size_t i = 0; i < len; i++) {
+				hash = (hash ^ p[i]) * 1099511628211ULL;
+			}
+			return hash;
+		};
+
+
+		/** \brief Hash in the style of wyhash, folding 128 bit products of 16 byte blocks
+		 * @param data Bytes to hash
+		 * @param len Number of bytes
+		 * @param seed Seed
+		 * @return Hash
+		 */
+		inline uint64_t Wy_Hash(const void *data, size_t len, uint64_t seed = 0) {
+			const unsigned char *p = (const unsigned char *)data;
+			uint64_t a, b;
+			seed ^= Mul_Fold(seed ^ PHASH_WY_P0, PHASH_WY_P1);
+
+			if (len <= 16) {
+				if (len >= 4) {
+					a = (Read32(p) << 32) | Read32(p + ((len >> 3) << 2));
+					b = (Read32(p + len - 4) << 32) | Read32(p + len - 4 - ((len >> 3) << 2));
+				}
+				else if (len > 0) {
+					a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+					b = 0;
+				}
+				else {
+					a = b = 0;
+				}
+			}
+			else {
+				size_t i = len;
+				for (; i > 16; i -= 16, p += 16) {
+					seed = Mul_Fold(Read64(p) ^ PHASH_WY_P1, Read64(p + 8) ^ seed);
+				}
+				a = Read64(p + i - 16);
+				b = Read64(p + i - 8);
+			}
+			return Mul_Fold(PHASH_WY_P1 ^ len, Mul_Fold(a ^ PHASH_WY_P1, b ^ seed));
+		};
+
+
+		/** \brief Hash in the style of xxh3, accumulating 32 byte stripes in four lanes and avalanching the result
+		 * @param data Bytes to hash
+		 * @param len Number of bytes
+		 * @param seed Seed
+		 * @return Hash
+		 */
+		inline uint64_t XXH3_Style(const void *data, size_t len, uint64_t seed = 0) {
+			const unsigned char *p = (const unsigned char *)data;
+			uint64_t acc = len * PHASH_XXH_P1 + seed;
+			size_t i = 0;
+
+			if (len >= 32) {
+				uint64_t lanes[4] = { seed + PHASH_XXH_P1, seed + PHASH_XXH_P2, seed, seed - PHASH_XXH_P1 };
+				for (; i + 32 <= len; i += 32) {
+					for (int l = 0; l < 4; l++) {
+						lanes[l] += Mul_Fold(Read64(p + i + l * 8) ^ PHASH_XXH_P3, lanes[l] ^ PHASH_XXH_P2);
+					}
+				}
+				acc += Mul_Fold(lanes[0] ^ lanes[1], PHASH_XXH_P1) + Mul_Fold(lanes[2] ^ lanes[3], PHASH_XXH_P2);
+			}
+			for (; i + 8 <= len; i += 8) {
+				acc = Mul_Fold(acc ^ Read64(p + i), PHASH_XXH_P2) + PHASH_XXH_P3;
+			}
+			if (i < len) {
+				uint64_t tail = 0;
+				memcpy(&tail, p + i, len - i);
+				acc = Mul_Fold(acc ^ tail, PHASH_XXH_P1);
+			}
+
+			// xxh3 avalanche
+			acc ^= acc >> 37;
+			acc *= 0x165667919E3779F9ULL;
+			acc ^= acc >> 32;
+			return acc;
+		};
+
+
+		/** \brief CRC32C (Castagnoli), using the SSE4.2 crc32 instruction where available
+		 * @param data Bytes to hash
+		 * @param len Number of bytes
+		 * @param crc CRC to continue from
+		 * @return CRC
+		 */
+		inline uint32_t CRC32C(const void *data, size_t len, uint32_t crc = 0) {
+			const unsigned char *p = (const unsigned char *)data;
+			crc = ~crc;
+#ifdef PHASH_HAS_SSE42
+#if defined(__x86_64__) || defined(_M_X64)
+			for (; len >= 8; len -= 8, p += 8) {
+				crc = (uint32_t)_mm_crc32_u64(crc, Read64(p));
+			}
+#endif
+			for (; len; len--, p++) {
+				crc = _mm_crc32_u8(crc, *p);
+			}
+#else
+			struct CRCTable {
+				uint32_t _Entry[256];
+				CRCTable(void) {
+					for (uint32_t i = 0; i < 256; i++) {
+						uint32_t c = i;
+						for (int k = 0; k < 8; k++) {
+							c = (c & 1) ? (c >> 1) ^ PHASH_CRC32C_POLY : c >> 1;
+						}
+						_Entry[i] = c;
+					}
+				};
+			};
+			static const CRCTable table;
+			for (; len; len--, p++) {
+				crc = table._Entry[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+			}
+#endif
+			return ~crc;
+		};
+
+
+		// byte views of keys: strings hash their characters, anything else its object representation
+		inline void Get_KeyBytes(const std::string &key, const void *&data, size_t &len) { data = key.data(); len = key.size(); };
+		inline void Get_KeyBytes(const char *key, const void *&data, size_t &len) { data = key; len = strlen(key); };
+#ifdef PHASH_HAS_STRING_VIEW
+		inline void Get_KeyBytes(std::string_view key, const void *&data, size_t &len) { data = key.data(); len = key.size(); };
+#endif
+		template <typename K>
+		inline void Get_KeyBytes(const K &key, const void *&data, size_t &len) {
+			static_assert(std::is_trivially_copyable<K>::value, "POD keys are hashed by their bytes, padding must be zeroed");
+			data = &key;
+			len = sizeof(K);
+		};
+	};
+
+
+	/** \brief Hash policies running a byte hash over a key's characters or bytes
+	 *
+	 * const char * keys are hashed as C strings by these policies.
+	 */
+	template <typename K>
+	struct PHashWy {
+		uint64_t operator()(const K &key) const { const void *data; size_t len; PHash::Get_KeyBytes(key, data, len); return PHash::Wy_Hash(data, len); };
+	};
+
+	template <typename K>
+	struct PHashXXH3 {
+		uint64_t operator()(const K &key) const { const void *data; size_t len; PHash::Get_KeyBytes(key, data, len); return PHash::XXH3_Style(data, len); };
+	};
+
+	template <typename K>
+	struct PHashFNV {
+		uint64_t operator()(const K &key) const { const void *data; size_t len; PHash::Get_KeyBytes(key, data, len); return PHash::FNV1a(data, len); };
+	};
+
+	// CRC32C only yields 32 bits, which are spread over the full word so the table's control bits get good ones
+	template <typename K>
+	struct PHashCRC32C {
+		uint64_t operator()(const K &key) const { const void *data; size_t len; PHash::Get_KeyBytes(key, data, len); return PHash::Mix64(PHash::CRC32C(data, len)); };
+	};
+
+
+	/** \brief Default hash policy: a multiply mix for integers, enums and pointers, wyhash for everything else
+	 *
+	 * Pointers, const char * included, hash by address, which suits keys interned in a PStringTable.
+	 */
+	template <typename K, bool IsScalar = std::is_integral<K>::value || std::is_enum<K>::value || std::is_pointer<K>::value>
+	struct PHashDefault : public PHashWy<K> {};
+
+	template <typename K>
+	struct PHashDefault<K, true> {
+		uint64_t operator()(K key) const { return PHash::Mix64(Get_Bits(key)); };
+
+		private:
+		template <typename U>
+		static uint64_t Get_Bits(U *key) { return (uint64_t)(uintptr_t)key; };
+		template <typename U>
+		static uint64_t Get_Bits(U key) { return (uint64_t)key; };
+	};
+
+}
+
+#endif
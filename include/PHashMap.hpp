@@ -0,0 +1,145 @@
+/** \file PHashMap.hpp
+ *  \brief Generic open addressing hash map
+ *
+ * A PFlatTable (a control byte per slot holding 7 bits of hash, 16 slot group probes, backward shift deletion)
+ * with the key type, hash and equality as template parameters.  Integer and pointer keys use a single multiply
+ * mix with the default hash policy, see PHashFunctions.hpp for the others.
+ */
+
+#pragma once
+
+#ifndef PHASHMAP_H
+#define PHASHMAP_H
+
+#include <stdint.h>
+#include <functional>
+#include <utility>
+#include "PHashFunctions.hpp"
+#include "PFlatTable.hpp"
+
+namespace PSTD {
+
+
+	/** \brief Hash map using open addressing with linear group probing
+	 *
+	 * The table doubles when it passes 7/8 full and removal leaves no tombstones.  Each slot keeps its key's
+	 * hash so growth and removal never rehash keys and most mismatches skip the equality test.
+	 * \tparam K Type of the keys
+	 * \tparam V Type of the values
+	 * \tparam Hash Functor returning a 64 bit hash of a key
+	 * \tparam Eq Functor comparing two keys for equality
+	 */
+	template <typename K, typename V, typename Hash = PHashDefault<K>, typename Eq = std::equal_to<K>>
+	class PHashMap {
+		public:
+
+		/** \brief Constructor
+		 * @param initialSize Number of keys the map should hold before it has to grow
+		 * @param hash Hash functor
+		 * @param eq Equality functor
+		 */
+		PHashMap(unsigned int initialSize = PFT_MIN_CAPACITY, const Hash &hash = Hash(), const Eq &eq = Eq()) :
+			_Table(initialSize),
+			_Hash(hash),
+			_Eq(eq)
+		{
+		};
+
+
+		/** \brief Add a key or replace the value of an existing one
+		 * @param key Key
+		 * @param val Value to store
+		 */
+		void Set(const K &key, V val) {
+			uint64_t hash = _Hash(key);
+			Slot *slot = Find_Slot(key, hash);
+
+			if (slot) {
+				slot->_Val = std::move(val);
+				return;
+			}
+			new (_Table.Insert(hash)) Slot(hash, key, std::move(val));
+		};
+
+
+		/** \brief Look up a key
+		 * @param key Key
+		 * @param val Receives the value if the key is found
+		 * @return True if the key was found
+		 */
+		bool Get(const K &key, V &val) const {
+			const V *found = Find(key);
+			if (!found) {
+				return false;
+			}
+			val = *found;
+			return true;
+		};
+
+
+		/** \brief Look up a key
+		 * @param key Key
+		 * @return Pointer to the key's value, NULL if the key is not in the map
+		 */
+		V *Find(const K &key) {
+			Slot *slot = Find_Slot(key, _Hash(key));
+			return (slot) ? &slot->_Val : NULL;
+		};
+
+		const V *Find(const K &key) const { return const_cast<PHashMap *>(this)->Find(key); };
+
+
+		/** \brief Remove a key
+		 * @param key Key
+		 * @return True if the key was in the map
+		 */
+		bool Remove(const K &key) {
+			Slot *slot = Find_Slot(key, _Hash(key));
+			if (!slot) {
+				return false;
+			}
+			_Table.Remove(slot);
+			return true;
+		};
+
+
+		/** \brief Make room for a number of keys without further growth
+		 * @param numKeys Number of keys
+		 */
+		void Reserve(unsigned int numKeys) { _Table.Reserve(numKeys); };
+
+
+		/** \brief Remove every key */
+		void Clear(void) { _Table.Clear(); };
+
+
+		unsigned int Get_NumKeys(void) const { return _Table.Get_NumKeys(); };
+		unsigned int Get_Capacity(void) const { return _Table.Get_Capacity(); };
+
+		private:
+		PHashMap(const PHashMap &);
+		PHashMap &operator=(const PHashMap &);
+
+		struct Slot {
+			uint64_t _Hash;
+			K _Key;
+			V _Val;
+
+			Slot(uint64_t hash, const K &key, V &&val) : _Hash(hash), _Key(key), _Val(std::move(val)) {};
+		};
+
+
+		Slot *Find_Slot(const K &key, uint64_t hash) const {
+			const Eq &eq = _Eq;
+			return _Table.Find(hash, [&](const Slot &slot) { return eq(slot._Key, key); });
+		};
+
+
+		PFlatTable<Slot> _Table;
+		Hash _Hash;
+		Eq _Eq;
+	};
+
+}
+
+#endif
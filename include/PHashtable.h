@@ -5,6 +5,11 @@
 
 #include <vector>
 #include <list>
+#include <iterator>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
 
 // basic string keyed hashtable with bucket chaining
 
@@ -22,12 +27,85 @@ namespace PSTD {
 		~HTNode() { if (_Key) free(_Key); }
 	};
 
+	template<typename T>
+	class PHashTable;
+
+
+	// forward iterator over the nodes of a PHashTable in memory order, the buckets first and then the overflow
+	//   blocks, so a walk never chases chain pointers.  V is T or const T
+	template<typename T, typename V>
+	class HTIterator {
+		public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef HTNode<T> value_type;
+		typedef ptrdiff_t difference_type;
+		typedef typename std::conditional<std::is_const<V>::value, const HTNode<T>, HTNode<T>>::type Node;
+		typedef Node *pointer;
+		typedef Node &reference;
+
+		HTIterator(void) : _HT(NULL), _Block(0), _Node(NULL), _End(NULL) {};
+		explicit HTIterator(const PHashTable<T> *ht) : _HT(ht), _Block(0), _Node(NULL), _End(NULL) {
+			_HT->Get_Block(0, _Node, _End);
+			Skip_Empty();
+		};
+
+		// mutable iterators convert to constant ones
+		HTIterator(const HTIterator<T, T> &it) : _HT(it._HT), _Block(it._Block), _Node(it._Node), _End(it._End) {};
+
+		Node &operator*(void) const { return *_Node; };
+		Node *operator->(void) const { return _Node; };
+
+		const char *Get_Key(void) const { return _Node->_Key; };
+		V &Get_Val(void) const { return _Node->_Val; };
+
+		HTIterator &operator++(void) {
+			_Node++;
+			Skip_Empty();
+			return *this;
+		};
+
+		HTIterator operator++(int) {
+			HTIterator prev = *this;
+			++*this;
+			return prev;
+		};
+
+		bool operator==(const HTIterator &it) const { return _Node == it._Node; };
+		bool operator!=(const HTIterator &it) const { return _Node != it._Node; };
+
+		private:
+		template<typename, typename> friend class HTIterator;
+
+		// move on to the next node holding a key, NULL once every block is done
+		void Skip_Empty(void) {
+			for (;;) {
+				for (; _Node < _End; _Node++) {
+					if (_Node->_Key) return;
+				}
+				if (!_HT->Get_Block(++_Block, _Node, _End)) {
+					_Node = NULL;
+					return;
+				}
+			}
+		}
+
+		const PHashTable<T> *_HT;
+		unsigned int _Block;
+		HTNode<T> *_Node;
+		HTNode<T> *_End;
+	};
+
+
 	template<typename T>
 	class PHashTable {
 		public:
-		PHashTable(unsigned int maxSize) : _TableSize(maxSize), _NumKeys(0), _OverflowCnt(0), _OverflowPos(0) {
-			_Table = new HTNode[_TableSize];
+		typedef HTIterator<T, T> iterator;
+		typedef HTIterator<T, const T> const_iterator;
 
+		// maxSize is rounded up to a power of two buckets
+		PHashTable(unsigned int maxSize) : _TableSize(1), _NumKeys(0), _OverflowCnt(0), _OverflowPos(HT_ALLOC_SIZE) {
+			while (_TableSize < maxSize) _TableSize <<= 1;
+			_Table = new HTNode<T>[_TableSize];
 		}
 
 
@@ -40,94 +118,132 @@ namespace PSTD {
 
 
 		void Set(const char *key, T val) {
+			HTNode<T> *node = &_Table[Hash_Key(key) & (_TableSize - 1)];
 
-			unsigned int hash = 2166136261;
-			for (const char *s = key; *s; s++) hash = (16777619 * hash) ^ (*s);
-			hash &= (_TableSize - 1)
-
-			if (!_Table[hash]._Key) {
-				_Table[hash]._Key = strdup(key);
-				_Table[hash]._Val = val;
+			if (!node->_Key) {
+				node->_Key = strdup(key);
+				node->_Val = val;
+				_NumKeys++;
 				return;
 			}
 
-			HTNode *node = &_HashTable[key];
-
-			// check for a matching key, if none exists add it to the string and hash table
-			do {
-
-				// replace existing key if it already exists
+			// replace existing key if it already exists
+			for (;;) {
 				if (!strcmp(node->_Key, key)) {
-					_Table[hash]._Val = val;
+					node->_Val = val;
 					return;
 				}
-				if (node->_Next) {
-					node = node->_Next;
-				}
-			} while (node->_Next);
+				if (!node->_Next) break;
+				node = node->_Next;
+			}
 
 			// out of overflow block size so make new one
 			if (_OverflowPos == HT_ALLOC_SIZE) {
-				HTNode *block = new HTNode[HT_ALLOC_SIZE];
+				HTNode<T> *block = new HTNode<T>[HT_ALLOC_SIZE];
 				_Overflow.push_back(block);
 				_OverflowPos = 0;
 				_OverflowCnt++;
 			}
 
-			_Table[hash]._Key = new char[strlen(key) + 1];
-			strdup(_Table[hash]._Key, key);
-			_Table[hash]._Val = val;
-
-			// add the string to the next available bucket
-			_Overflow.back()[_OverflowPos]._Key = strdup(key); 
-			_Overflow.back()[_OverflowPos]._Val = val;
-			node->_Next = &_Overflow.back()[_OverflowPos++];
+			// add the string to the next available node at the end of the chain
+			HTNode<T> *added = &_Overflow.back()[_OverflowPos++];
+			added->_Key = strdup(key);
+			added->_Val = val;
+			node->_Next = added;
 			_NumKeys++;
 		}
 
 
 		bool Get(const char *key, T &val) const {
-			unsigned int hash = 2166136261;
-			for (const char *s = key; *s; s++) hash = (16777619 * hash) ^ (*s);
-			hash &= (_TableSize - 1)
-
-				// check in main bucket
-			if (!_Table[hash]._Key) return false;
+			HTNode<T> *node = &_Table[Hash_Key(key) & (_TableSize - 1)];
 
-			HTNode *node = &_HashTable[key];
+			// check in main bucket
+			if (!node->_Key) return false;
 
 			// check in chained bucket
-			do {
-
-				// found in chain bucket
+			for (; node; node = node->_Next) {
 				if (!strcmp(node->_Key, key)) {
-					return node->_Val;
+					val = node->_Val;
+					return true;
 				}
-			} while (node = node->_Next);
-
+			}
 			return false;
 		}
 
 
-		std::list<T> *Get_ItemList(void) {
-			std::list<T> *items = new std::list<T>();
+		iterator begin(void) { return iterator(this); };
+		iterator end(void) { return iterator(); };
+		const_iterator begin(void) const { return const_iterator(this); };
+		const_iterator end(void) const { return const_iterator(); };
+		const_iterator cbegin(void) const { return const_iterator(this); };
+		const_iterator cend(void) const { return const_iterator(); };
+
 
-			for (unsigned int i = 0; i < _TableSize; i++) {
-				if (_Table[i]._Key) {
-					items->push_back(_Table[i]._Val);
+		// call func(key, val) for every key, in memory order rather than bucket order
+		template<typename Func>
+		void For_Each(Func func) {
+			HTNode<T> *node, *end;
+			for (unsigned int i = 0; Get_Block(i, node, end); i++) {
+				for (; node < end; node++) {
+					if (node->_Key) func((const char *)node->_Key, node->_Val);
 				}
 			}
-			for (int i = 0; i < _OverflowCnt - 1; i++) {
-				for (unsigned int j = 0; j < HT_ALLOC_SIZE; j++) {
-					items->push_back(_Overflow[i][j]);
+		}
+
+
+		// copy up to maxCnt keys and values into caller provided arrays, either may be NULL
+		//   returns the number of items copied
+		unsigned int Export_Items(const char **keys, T *vals, unsigned int maxCnt) const {
+			unsigned int cnt = 0;
+			HTNode<T> *node, *end;
+			for (unsigned int i = 0; (cnt < maxCnt) && Get_Block(i, node, end); i++) {
+				for (; (node < end) && (cnt < maxCnt); node++) {
+					if (!node->_Key) continue;
+					if (keys) keys[cnt] = node->_Key;
+					if (vals) vals[cnt] = node->_Val;
+					cnt++;
 				}
 			}
-			for (unsigned int i = 0; i < _OverflowPos; i++) {
-				items->push_back(_Overflow[_OverflowCnt][j]);
+			return cnt;
+		}
+
+
+		// allocates a list node per item, prefer the iterators or Export_Items
+		std::list<T> *Get_ItemList(void) {
+			std::list<T> *items = new std::list<T>();
+			for (iterator it = begin(); it != end(); ++it) {
+				items->push_back(it->_Val);
 			}
 			return items;
 		}
-		unsigned int Get_NumKeys(void) { return _NumKeys; };
+		unsigned int Get_NumKeys(void) const { return _NumKeys; };
+
+
+		private:
+		friend class HTIterator<T, T>;
+		friend class HTIterator<T, const T>;
+
+		static unsigned int Hash_Key(const char *key) {
+			unsigned int hash = 2166136261;
+			for (const char *s = key; *s; s++) hash = (16777619 * hash) ^ (*s);
+			return hash;
+		}
+
+
+		// node range of block i, the buckets are block 0 and the overflow blocks follow
+		//   returns false past the last block
+		bool Get_Block(unsigned int i, HTNode<T> *&begin, HTNode<T> *&end) const {
+			if (i == 0) {
+				begin = _Table;
+				end = _Table + _TableSize;
+				return true;
+			}
+			if (i > _OverflowCnt) return false;
+
+			begin = _Overflow[i - 1];
+			end = begin + ((i == _OverflowCnt) ? _OverflowPos : HT_ALLOC_SIZE);
+			return true;
+		}
 
 
 		HTNode<T> *_Table;
@@ -0,0 +1,134 @@
+/** \file PNumaPool.hpp
+ *  \brief NUMA node aware sets of pooled memory managers
+ *
+ * Keeps one pool per NUMA node, each taking its blocks from memory bound to that node, so threads can allocate
+ * objects which are local to the socket they run on.
+ */
+
+#pragma once
+
+#ifndef PNUMAPOOL_H
+#define PNUMAPOOL_H
+
+#include <stdio.h>
+#include <vector>
+#include "PooledMemManager.hpp"
+
+namespace PSTD {
+	namespace PNuma {
+
+
+		/** \brief Read the number of NUMA node ids from the system, see Get_NumNodes */
+		inline int Read_NumNodes(void) {
+#ifdef _MSC_VER
+			ULONG highest = 0;
+			return (GetNumaHighestNodeNumber(&highest)) ? (int)highest + 1 : 1;
+#else
+			// a list of ids and ranges such as "0-3,8", node ids need not be contiguous
+			FILE *file = fopen("/sys/devices/system/node/possible", "r");
+			if (!file) {
+				return 1;
+			}
+			int highest = 0;
+			int first, last;
+			while (fscanf(file, "%d", &first) == 1) {
+				last = first;
+				int sep = fgetc(file);
+				if ((sep == '-') && (fscanf(file, "%d", &last) == 1)) {
+					sep = fgetc(file);
+				}
+				if (last > highest) {
+					highest = last;
+				}
+				if (sep != ',') {
+					break;
+				}
+			}
+			fclose(file);
+			return (highest < PBS_MAX_NUMA_NODES) ? highest + 1 : PBS_MAX_NUMA_NODES;
+#endif
+		};
+
+
+		/** \brief Get the number of NUMA nodes in the system
+		 * @return One more than the highest possible node id, so sparse ids get a slot each; 1 on systems without
+		 *         NUMA support
+		 */
+		inline int Get_NumNodes(void) {
+			static const int numNodes = Read_NumNodes();
+			return numNodes;
+		};
+
+
+		/** \brief Get the NUMA node of the processor the calling thread is running on
+		 * @return Node number, 0 if it can't be determined
+		 */
+		inline int Get_CurrentNode(void) {
+#ifdef _MSC_VER
+			PROCESSOR_NUMBER proc;
+			USHORT node;
+			GetCurrentProcessorNumberEx(&proc);
+			return (GetNumaProcessorNodeEx(&proc, &node)) ? (int)node : 0;
+#elif defined(SYS_getcpu)
+			unsigned int cpu;
+			unsigned int node;
+			return (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) ? (int)node : 0;
+#else
+			return 0;
+#endif
+		};
+	};
+
+
+	/** \brief A pool per NUMA node
+	 *
+	 * Each node's pool is an ordinary PoolMemManager and has the same threading rules.  Objects must be returned
+	 * to the pool they came from.
+	 * \tparam T Type of object to manage
+	 */
+	template <typename T>
+	class PNumaPoolSet {
+		public:
+		typedef PoolMemManager<T, PNumaBlockSource> NodePool;
+
+		/** \brief Constructor
+		 * @param objPerNode The initial size of each node's pool
+		 * @param growPool Flag indicating if the pools should grow if they run out of memory
+		 * @param chunkAlign Alignment of every chunk, PSTD_CACHELINE_SIZE by default to avoid false sharing
+		 */
+		PNumaPoolSet(int objPerNode, bool growPool = false, unsigned int chunkAlign = PSTD_CACHELINE_SIZE) {
+			int numNodes = PNuma::Get_NumNodes();
+			for (int i = 0; i < numNodes; i++) {
+				_Pools.push_back(new NodePool(objPerNode, growPool, chunkAlign, PNumaBlockSource(i)));
+			}
+		};
+
+		~PNumaPoolSet(void) {
+			for (size_t i = 0; i < _Pools.size(); i++) {
+				delete _Pools[i];
+			}
+		};
+
+		/** \brief Get the pool of a given node
+		 * @param node Node number
+		 * @return The node's pool
+		 */
+		NodePool *Get_NodePool(int node) { return _Pools[(node < (int)_Pools.size()) ? node : 0]; };
+
+		/** \brief Get the pool of the node the calling thread is running on
+		 * @return The local node's pool
+		 */
+		NodePool *Get_LocalPool(void) { return Get_NodePool(PNuma::Get_CurrentNode()); };
+
+		int Get_NumNodes(void) { return (int)_Pools.size(); };
+
+		private:
+		PNumaPoolSet(const PNumaPoolSet &);
+		PNumaPoolSet &operator=(const PNumaPoolSet &);
+
+		std::vector<NodePool *> _Pools;
+	};
+
+}
+
+#endif
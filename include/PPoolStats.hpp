@@ -0,0 +1,219 @@
+/** \file PPoolStats.hpp
+ *  \brief Optional allocation instrumentation for the pooled memory managers
+ *
+ * When PSTD_POOL_STATS is defined every PoolMemManager keeps a set of named counters (current and peak usage,
+ * block growth, failed allocations, allocation rate) and registers them with PPoolRegistry, which can dump all
+ * live pools as text or JSON.  Without PSTD_POOL_STATS the counters and their updates compile away entirely.
+ *
+ * The counters are only ever written by the thread owning the pool, but a dump may run on any thread, so they are
+ * relaxed atomics.  The owner updates them with plain loads and stores, which cost the same as the non atomic
+ * increments would, and a dump sees each counter whole even if the set of counters is not a single snapshot.
+ */
+
+#pragma once
+
+#ifndef PPOOLSTATS_H
+#define PPOOLSTATS_H
+
+#ifdef PSTD_POOL_STATS
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace PSTD {
+
+
+	/** \brief Counters kept for a single pool */
+	struct PPoolStats {
+		std::string _Name;								// Name the pool is reported under, only changed under the registry lock
+		unsigned int _ChunkSize;						// Size of each chunk in bytes
+		std::atomic<uint64_t> _NumAllocated;			// Objects currently handed out
+		std::atomic<uint64_t> _PeakAllocated;			// High water mark of _NumAllocated
+		std::atomic<uint64_t> _Capacity;				// Objects the pool's blocks can hold
+		std::atomic<uint64_t> _PeakCapacity;			// High water mark of _Capacity
+		std::atomic<uint64_t> _TotalAllocs;				// Allocations over the lifetime of the pool
+		std::atomic<uint64_t> _TotalFrees;				// Frees over the lifetime of the pool
+		std::atomic<uint64_t> _NumGrowth;				// Number of blocks added after construction
+		std::atomic<uint64_t> _NumFailedAllocs;			// Allocations refused because the pool could not grow
+
+		uint64_t _LastDumpAllocs;						// _TotalAllocs when the pool was last reported, dumper only
+		std::chrono::steady_clock::time_point _LastDumpTime;
+
+		PPoolStats(void) :
+			_Name("PoolMemManager"),
+			_ChunkSize(0),
+			_NumAllocated(0),
+			_PeakAllocated(0),
+			_Capacity(0),
+			_PeakCapacity(0),
+			_TotalAllocs(0),
+			_TotalFrees(0),
+			_NumGrowth(0),
+			_NumFailedAllocs(0),
+			_LastDumpAllocs(0),
+			_LastDumpTime(std::chrono::steady_clock::now()) {};
+
+		void On_Alloc(uint64_t cnt) {
+			uint64_t allocated = Add(_NumAllocated, cnt);
+			Add(_TotalAllocs, cnt);
+			if (allocated > _PeakAllocated.load(std::memory_order_relaxed)) {
+				_PeakAllocated.store(allocated, std::memory_order_relaxed);
+			}
+		};
+
+		void On_Free(uint64_t cnt) {
+			_NumAllocated.store(_NumAllocated.load(std::memory_order_relaxed) - cnt, std::memory_order_relaxed);
+			Add(_TotalFrees, cnt);
+		};
+
+		void On_FreeAll(void) {
+			On_Free(_NumAllocated.load(std::memory_order_relaxed));
+		};
+
+		void On_Failed(uint64_t cnt) {
+			Add(_NumFailedAllocs, cnt);
+		};
+
+		void On_AddBlock(uint64_t objCnt, bool growth) {
+			Add(_NumGrowth, growth);
+			uint64_t capacity = Add(_Capacity, objCnt);
+			if (capacity > _PeakCapacity.load(std::memory_order_relaxed)) {
+				_PeakCapacity.store(capacity, std::memory_order_relaxed);
+			}
+		};
+
+		void On_ReleaseBlock(uint64_t objCnt) {
+			_Capacity.store(_Capacity.load(std::memory_order_relaxed) - objCnt, std::memory_order_relaxed);
+		};
+
+		private:
+		PPoolStats(const PPoolStats &);
+		PPoolStats &operator=(const PPoolStats &);
+
+		// only the owning thread writes a counter, so it needs no read-modify-write
+		static uint64_t Add(std::atomic<uint64_t> &counter, uint64_t cnt) {
+			uint64_t value = counter.load(std::memory_order_relaxed) + cnt;
+			counter.store(value, std::memory_order_relaxed);
+			return value;
+		};
+	};
+
+
+	/** \brief Registry of the instrumented pools which are currently alive */
+	class PPoolRegistry {
+		public:
+
+		static void Register(PPoolStats *stats) {
+			std::lock_guard<std::mutex> lock(Get_Lock());
+			Get_Pools().push_back(stats);
+		};
+
+		static void Unregister(PPoolStats *stats) {
+			std::lock_guard<std::mutex> lock(Get_Lock());
+			std::vector<PPoolStats *> &pools = Get_Pools();
+			for (size_t i = 0; i < pools.size(); i++) {
+				if (pools[i] == stats) {
+					pools.erase(pools.begin() + i);
+					return;
+				}
+			}
+		};
+
+
+		/** \brief Change the name a pool is reported under
+		 * @param stats Counters of the pool
+		 * @param name Pool name
+		 */
+		static void Rename(PPoolStats *stats, const char *name) {
+			std::lock_guard<std::mutex> lock(Get_Lock());
+			stats->_Name = name;
+		};
+
+
+		/** \brief Report all pools as human readable text, one pool per line
+		 * @return Report
+		 */
+		static std::string Dump_Text(void) {
+			std::lock_guard<std::mutex> lock(Get_Lock());
+			std::vector<PPoolStats *> &pools = Get_Pools();
+			std::string out;
+			char buf[512];
+
+			for (size_t i = 0; i < pools.size(); i++) {
+				PPoolStats *s = pools[i];
+				snprintf(buf, sizeof(buf), "%s: chunk %u  used %llu  peak %llu  capacity %llu  peak capacity %llu  allocs %llu  frees %llu  growth %llu  failed %llu  rate %.1f/s\n",
+					s->_Name.c_str(), s->_ChunkSize, Get(s->_NumAllocated), Get(s->_PeakAllocated),
+					Get(s->_Capacity), Get(s->_PeakCapacity), Get(s->_TotalAllocs),
+					Get(s->_TotalFrees), Get(s->_NumGrowth), Get(s->_NumFailedAllocs), Take_AllocRate(s));
+				out += buf;
+			}
+			return out;
+		};
+
+
+		/** \brief Report all pools as a JSON array of objects
+		 * @return Report
+		 */
+		static std::string Dump_JSON(void) {
+			std::lock_guard<std::mutex> lock(Get_Lock());
+			std::vector<PPoolStats *> &pools = Get_Pools();
+			std::string out = "[";
+			char buf[512];
+
+			for (size_t i = 0; i < pools.size(); i++) {
+				PPoolStats *s = pools[i];
+				out += (i) ? ",\n {\"name\": \"" : "\n {\"name\": \"";
+				for (size_t c = 0; c < s->_Name.size(); c++) {
+					if ((s->_Name[c] == '"') || (s->_Name[c] == '\\')) {
+						out += '\\';
+					}
+					out += s->_Name[c];
+				}
+				snprintf(buf, sizeof(buf), "\", \"chunk_size\": %u, \"used\": %llu, \"peak_used\": %llu, \"capacity\": %llu, \"peak_capacity\": %llu, "
+					"\"allocs\": %llu, \"frees\": %llu, \"growth\": %llu, \"failed\": %llu, \"alloc_rate\": %.1f}",
+					s->_ChunkSize, Get(s->_NumAllocated), Get(s->_PeakAllocated),
+					Get(s->_Capacity), Get(s->_PeakCapacity), Get(s->_TotalAllocs),
+					Get(s->_TotalFrees), Get(s->_NumGrowth), Get(s->_NumFailedAllocs), Take_AllocRate(s));
+				out += buf;
+			}
+			out += "\n]\n";
+			return out;
+		};
+
+		private:
+
+		static unsigned long long Get(const std::atomic<uint64_t> &counter) {
+			return (unsigned long long)counter.load(std::memory_order_relaxed);
+		};
+
+		// allocations per second since the pool was last reported, the last dump fields are guarded by the registry lock
+		static double Take_AllocRate(PPoolStats *s) {
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			uint64_t allocs = s->_TotalAllocs.load(std::memory_order_relaxed);
+			double secs = std::chrono::duration<double>(now - s->_LastDumpTime).count();
+			double rate = (secs > 0.0) ? (double)(allocs - s->_LastDumpAllocs) / secs : 0.0;
+			s->_LastDumpAllocs = allocs;
+			s->_LastDumpTime = now;
+			return rate;
+		};
+
+		static std::mutex &Get_Lock(void) { static std::mutex lock; return lock; };
+		static std::vector<PPoolStats *> &Get_Pools(void) { static std::vector<PPoolStats *> pools; return pools; };
+	};
+
+}
+
+#define PMM_STAT(x) x
+
+#else
+
+#define PMM_STAT(x)
+
+#endif
+
+#endif
@@ -26,32 +26,129 @@
  **************************************************************************************************/
 #define STRINGTABLE_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
+#include "PHashFunctions.hpp"
+#include "PCacheLine.hpp"
 
 
 /**************************************************************************************************
- * @def	ST_HT_ALLOC_SIZE
+ * @def	ST_MIN_CHUNK_SIZE
  *
- * @brief	When hash table overflow occurs, how many new STNodes should we allocate at a time.
+ * @brief	Smallest block of string storage, the table's maxSize is rounded up to a power of two
+ * 			between this and ST_MAX_CHUNK_SIZE.
  **************************************************************************************************/
-#define ST_HT_ALLOC_SIZE	256
+#define ST_MIN_CHUNK_SIZE	(4 * 1024)
+#define ST_MAX_CHUNK_SIZE	(1024 * 1024)
+
+
+/**************************************************************************************************
+ * @def	ST_MIN_INDEX_SIZE
+ *
+ * @brief	Smallest number of slots in the hash index.
+ **************************************************************************************************/
+#define ST_MIN_INDEX_SIZE	64
+
+
+/**************************************************************************************************
+ * @def	ST_NUM_STRIPES
+ *
+ * @brief	Number of locks new strings are spread over in concurrent mode, a power of two of at most
+ * 			ST_MIN_INDEX_SIZE / 4 so inserts racing past the load check can't fill the index.
+ **************************************************************************************************/
+#define ST_NUM_STRIPES		16
+
+
+/**************************************************************************************************
+ * @def	ST_INVALID_NUM
+ *
+ * @brief	String number which refers to no string, marks empty index slots.
+ **************************************************************************************************/
+#define ST_INVALID_NUM		0xFFFFFFFF
+
+
+/**************************************************************************************************
+ * @def	ST_HEADER_SIZE
+ *
+ * @brief	Bytes in front of each string holding its 64 bit hash and 32 bit length.  Records of
+ * 			header and string start on ST_RECORD_ALIGN byte boundaries.
+ **************************************************************************************************/
+#define ST_HEADER_SIZE		12
+#define ST_RECORD_ALIGN		8
+
+
+/**************************************************************************************************
+ * @def	ST_BATCH_SIZE
+ *
+ * @brief	Number of strings Add_Buffer hashes and prefetches index slots for before looking
+ * 			them up.
+ **************************************************************************************************/
+#define ST_BATCH_SIZE		16
 
 namespace PSTD {
 
 
 	/**************************************************************************************************
-	 * @struct	STNode
+	 * @class	PInternedString
 	 *
-	 * @brief	The node used for the hash table in the string table.
+	 * @brief	Handle to a string in a PStringTable which knows the string's length and hash without
+	 * 			scanning it, both are read from the header the table stores in front of the string.
+	 * 			Two handles from the same table are equal only if they refer to the same string, so
+	 * 			comparing them is a pointer compare.  Hashing one with PHashDefault returns the stored
+	 * 			hash, which makes it a key for the PSTD hash containers that is never rehashed.
 	 **************************************************************************************************/
-	struct STNode {
-		/** @brief	! Represents string in the string table as well as key in hash table. */
-		char *_Key;
-		/** @brief	! Next bucket for collision chaining. */
-		STNode *_Next;
+	class PInternedString {
+		public:
+
+		//! Handle to no string, only Is_Valid and comparisons may be used on it
+		PInternedString(void) : _Str(NULL) {};
+
+		/**************************************************************************************************
+		 * @fn	explicit PInternedString::PInternedString(const char *str)
+		 *
+		 * @brief	Wrap a string returned by PStringTable::Get_String.
+		 *
+		 * @param	str	Address of a string in a string table, any other string is undefined.
+		 **************************************************************************************************/
+		explicit PInternedString(const char *str) : _Str(str) {};
+
+
+		const char *Get_String(void) const { return _Str; };
+		uint32_t Get_Length(void) const { uint32_t len; memcpy(&len, _Str - sizeof(uint32_t), sizeof(len)); return len; };
+		uint64_t Get_Hash(void) const { uint64_t hash; memcpy(&hash, _Str - ST_HEADER_SIZE, sizeof(hash)); return hash; };
+		bool Is_Valid(void) const { return _Str != NULL; };
+
+		bool operator==(const PInternedString &str) const { return _Str == str._Str; };
+		bool operator!=(const PInternedString &str) const { return _Str != str._Str; };
+
 
-		STNode() : _Key(NULL), _Next(NULL) {};
+		/**************************************************************************************************
+		 * @fn	static uint64_t PInternedString::Hash_String(const char *str, size_t len)
+		 *
+		 * @brief	The hash string tables store for a string, for matching plain strings against
+		 * 			interned ones.
+		 *
+		 * @param	str	String to hash.
+		 * @param	len	Length of the string.
+		 *
+		 * @return	The hash.
+		 **************************************************************************************************/
+		static uint64_t Hash_String(const char *str, size_t len) { return PHash::Wy_Hash(str, len); };
+
+		private:
+		const char *_Str;
+	};
+
+
+	/** @brief	Interned strings hash to the hash stored with them. */
+	template <>
+	struct PHashDefault<PInternedString, false> {
+		uint64_t operator()(const PInternedString &key) const { return key.Get_Hash(); };
 	};
 
 
@@ -62,18 +159,36 @@ namespace PSTD {
 	 * 			subsequent access  Once the string table is destroyed, any and all references to its
 	 * 			strings will be
 	 * 			  garbage.
+	 *
+	 * 			Strings are stored in chunks which are never moved or freed while the table exists, so
+	 * 			addresses handed out stay valid as the table grows.  A string's number encodes its chunk
+	 * 			in the high bits and its offset in the chunk in the low bits.  Each string is preceded
+	 * 			by its hash and length (see PInternedString), so lookups compare lengths before bytes
+	 * 			and callers holding a handle never rescan the string.
+	 *
+	 * 			In concurrent mode any number of threads may add and look up strings at once.  Strings
+	 * 			already in the table are found without taking a lock, a new string takes one of
+	 * 			ST_NUM_STRIPES locks picked by its hash and its bytes are placed by atomically bumping
+	 * 			the storage offset.  Indexes and chunk directories replaced by growth are kept until
+	 * 			the table is destroyed since lock free readers may still be using them.
+	 *
+	 * 			A table can be saved to a file holding its storage and index, which refer to strings
+	 * 			by number only, and mapped back by a new table without copying or rehashing.  Strings
+	 * 			added to a mapped table go into heap chunks numbered after the mapped ones.
 	 **************************************************************************************************/
 	class PStringTable {
 		public:
 
 		/**************************************************************************************************
-		 * @fn	PStringTable::PStringTable(unsigned int maxSize);
+		 * @fn	PStringTable::PStringTable(unsigned int maxSize, bool concurrent = false);
 		 *
 		 * @brief	Constructor.
 		 *
-		 * @param	maxSize	Maximum size of the string table.
+		 * @param	maxSize	  	Expected size of the string table in bytes, sets the size of its
+		 * 			storage chunks and initial hash index.  The table grows past it as needed.
+		 * @param	concurrent	True if several threads will use the table at once.
 		 **************************************************************************************************/
-		PStringTable(unsigned int maxSize);
+		PStringTable(unsigned int maxSize, bool concurrent = false);
 
 
 		/**************************************************************************************************
@@ -92,7 +207,7 @@ namespace PSTD {
 		 *
 		 * @param	sstring	String to look for/add to the table.
 		 *
-		 * @return	Address of the string in the table.
+		 * @return	Address of the string in the table, NULL if the table's storage is exhausted.
 		 **************************************************************************************************/
 		const char *Get_String(const char *sstring);
 
@@ -110,6 +225,31 @@ namespace PSTD {
 		const char *Get_String(const std::string &sstring);
 
 
+		/**************************************************************************************************
+		 * @fn	PInternedString PStringTable::Get_Interned(const char *sstring);
+		 *
+		 * @brief	Get a handle to the given string, adding it to the table if it is not already there.
+		 *
+		 * @param	sstring	String to look for/add to the table.
+		 *
+		 * @return	Handle to the string in the table, invalid if the table's storage is exhausted.
+		 **************************************************************************************************/
+		PInternedString Get_Interned(const char *sstring) { return PInternedString(Get_String(sstring)); };
+		PInternedString Get_Interned(const std::string &sstring) { return PInternedString(Get_String(sstring)); };
+
+
+		/**************************************************************************************************
+		 * @fn	PInternedString PStringTable::Get_Interned(unsigned int strnum) const;
+		 *
+		 * @brief	Get a handle to the string with a given index.
+		 *
+		 * @param	strnum	Index of the string in the table.
+		 *
+		 * @return	Handle to the indexed string.
+		 **************************************************************************************************/
+		PInternedString Get_Interned(unsigned int strnum) const { return PInternedString(Get_String(strnum)); };
+
+
 		/**************************************************************************************************
 		 * @fn	unsigned int PStringTable::Get_StringNum(const char *sstring);
 		 *
@@ -117,7 +257,7 @@ namespace PSTD {
 		 *
 		 * @param	sstring	String to get the index of.
 		 *
-		 * @return	Index into table or -1 if the given string is not in the table.
+		 * @return	Index into table, ST_INVALID_NUM if the table's storage is exhausted.
 		 **************************************************************************************************/
 		unsigned int Get_StringNum(const char *sstring);
 
@@ -132,7 +272,7 @@ namespace PSTD {
 		 *
 		 * @return	Address of the indexed string.
 		 **************************************************************************************************/
-		const char *Get_String(unsigned int strnum);
+		const char *Get_String(unsigned int strnum) const;
 
 
 		/**************************************************************************************************
@@ -146,7 +286,7 @@ namespace PSTD {
 		/**************************************************************************************************
 		 * @fn	size_t StringTable::Get_TableSize(void)
 		 *
-		 * @brief	Get the size of the table in bytes.
+		 * @brief	Get the size of the table's string storage in bytes.
 		 *
 		 * @return	Size of table in bytes.
 		 **************************************************************************************************/
@@ -166,102 +306,256 @@ namespace PSTD {
 		/**************************************************************************************************
 		 * @fn	void PStringTable::Add_Buffer(const char *buffer, int size);
 		 *
-		 * @brief	Add a buffer of null terminated strings into a string table.
+		 * @brief	Add a buffer of null terminated strings into a string table.  The strings are
+		 * 			split, hashed and looked up ST_BATCH_SIZE at a time, and a last string running to
+		 * 			the end of the buffer without a terminator is added as well.
 		 *
 		 * @param	buffer	Buffer containing null terminated strings.
 		 * @param	size  	Size of the buffer.
 		 **************************************************************************************************/
 		void Add_Buffer(const char *buffer, int size);
 
+
+		/**************************************************************************************************
+		 * @fn	bool PStringTable::Save_Table(const char *fileName);
+		 *
+		 * @brief	Write the table's storage and hash index to a file which Map_Table can load.  In
+		 * 			concurrent mode additions wait until the table has been written.
+		 *
+		 * @param	fileName	Name of the file to write.
+		 *
+		 * @return	True if the file was written.
+		 **************************************************************************************************/
+		bool Save_Table(const char *fileName);
+
+
+		/**************************************************************************************************
+		 * @fn	bool PStringTable::Map_Table(const char *fileName);
+		 *
+		 * @brief	Memory map a file written by Save_Table as the contents of this table, which must
+		 * 			be empty, not mapped already and not yet shared between threads.  The mapping is private, so the index
+		 * 			pages touched by later additions are copied on write and the file is never changed.
+		 * 			The file must have been written by a build with the same byte order and hash.  The
+		 * 			header, chunk table and every index entry are checked before the file is used, which
+		 * 			reads each record's header once.
+		 *
+		 * @param	fileName	Name of the file to map.
+		 *
+		 * @return	True if the file was mapped, otherwise the table is left as it was.
+		 **************************************************************************************************/
+		bool Map_Table(const char *fileName);
+
 		private:
+		PStringTable(const PStringTable &);
+		PStringTable &operator=(const PStringTable &);
+
 
 		/**************************************************************************************************
-		 * @fn	size_t PStringTable::Hash(const char *key) const;
+		 * @fn	uint64_t PStringTable::Hash(const char *key, size_t len) const;
 		 *
 		 * @brief	Hashes the given key.
 		 *
 		 * @param	key	The key.
+		 * @param	len	Length of the key.
 		 *
 		 * @return	The hash.
 		 **************************************************************************************************/
-		size_t Hash(const char *key) const;
+		uint64_t Hash(const char *key, size_t len) const;
 
 
-		/** @brief	The hash table. */
-		STNode *_HashTable;
+		/**************************************************************************************************
+		 * @struct	STIndex
+		 *
+		 * @brief	Open addressing hash index, probed linearly.  Each entry packs the low 32 bits of
+		 * 			a string's hash above its number so it can be read and written atomically.
+		 **************************************************************************************************/
+		struct STIndex {
+			STIndex(unsigned int size);
+			STIndex(unsigned int size, std::atomic<uint64_t> *mapped);
+			~STIndex(void);
+
+			unsigned int _Size;
+			std::atomic<uint64_t> *_Entries;
+			bool _Mapped;
+		};
+
+
+		/** @brief	A stripe lock aligned to its own cache line. */
+		struct alignas(PSTD_CACHELINE_SIZE) STStripe {
+			std::mutex _Lock;
+		};
 
 
 		/**************************************************************************************************
-		 * @brief	The buffer.
+		 * @fn	unsigned int PStringTable::Intern(const char *sstring, size_t len, uint64_t hash);
+		 *
+		 * @brief	Find a string in the table, adding it if it is not there.
 		 *
-		 * ### summary	@brief	The buffer used to store string.
+		 * @param	sstring	String to look for/add to the table, need not be null terminated.
+		 * @param	len	   	Length of the string.
+		 * @param	hash   	Hash of the string.
+		 *
+		 * @return	Number of the string, ST_INVALID_NUM if the table's storage is exhausted.
 		 **************************************************************************************************/
-		char *_StrBuffer;
+		unsigned int Intern(const char *sstring, size_t len, uint64_t hash);
 
 
 		/**************************************************************************************************
-		 * @brief	Size of the table.
+		 * @fn	unsigned int PStringTable::Find_String(const char *sstring, size_t len, uint64_t hash) const;
+		 *
+		 * @brief	Look up a string without taking a lock.
 		 *
-		 * ### summary	@brief	Size of the string table buffer.
+		 * @param	sstring	String to look for.
+		 * @param	len	   	Length of the string.
+		 * @param	hash   	Hash of the string.
+		 *
+		 * @return	Number of the string, ST_INVALID_NUM if it is not in the table.
 		 **************************************************************************************************/
-		size_t _STTableSize;
+		unsigned int Find_String(const char *sstring, size_t len, uint64_t hash) const;
 
 
 		/**************************************************************************************************
-		 * @brief	The current index.
+		 * @fn	bool PStringTable::Match_String(unsigned int num, const char *sstring, size_t len, uint64_t hash) const;
 		 *
-		 * ### summary	@brief	The current buffer index for additions into the string table.
+		 * @brief	Compare a string in the table against another by hash, then length, then bytes.
+		 *
+		 * @param	num	   	Number of the string in the table.
+		 * @param	sstring	String to compare with.
+		 * @param	len	   	Length of the string.
+		 * @param	hash   	Hash of the string.
+		 *
+		 * @return	True if the strings are equal.
 		 **************************************************************************************************/
-		size_t _STCurrentIndex;
+		bool Match_String(unsigned int num, const char *sstring, size_t len, uint64_t hash) const;
 
 
 		/**************************************************************************************************
-		 * @brief	Size of the height table.
+		 * @fn	unsigned int PStringTable::Store_String(const char *sstring, size_t len, uint64_t hash);
+		 *
+		 * @brief	Copy a string and its header into the storage chunks, starting a new chunk if it
+		 * 			doesn't fit.
+		 *
+		 * @param	sstring	String to copy.
+		 * @param	len	   	Length of the string.
+		 * @param	hash   	Hash of the string.
 		 *
-		 * ### summary	@brief	Number of buckets in the hash table (without chaining).
+		 * @return	Number of the copy, ST_INVALID_NUM if the table's storage is exhausted.
 		 **************************************************************************************************/
-		unsigned int _HTTableSize;
+		unsigned int Store_String(const char *sstring, size_t len, uint64_t hash);
 
 
 		/**************************************************************************************************
-		 * @brief	Size of the height allocate block.
+		 * @fn	unsigned int PStringTable::Add_Chunk(size_t size);
 		 *
-		 * ### summary	@brief	Size of the height allocate block.
+		 * @brief	Allocate a chunk of storage, must be called with the storage lock held.
+		 *
+		 * @param	size	Size of the chunk in bytes.
+		 *
+		 * @return	Index of the chunk, ST_INVALID_NUM if no more chunks can be numbered.
 		 **************************************************************************************************/
-		//unsigned int _HTAllocBlockSize;
+		unsigned int Add_Chunk(size_t size);
 
 
 		/**************************************************************************************************
-		 * @brief	The height number keys.
+		 * @fn	void PStringTable::Grow_Index(STIndex *index);
 		 *
-		 * ### summary	@brief	The number of strings in the hash table.
+		 * @brief	Double the number of slots in the hash index, unless another thread already has.
+		 *
+		 * @param	index	The index which was found to be too full.
+		 **************************************************************************************************/
+		void Grow_Index(STIndex *index);
+
+
+		/**************************************************************************************************
+		 * @brief	The hash index.
+		 *
+		 * ### summary	@brief	Current hash index, replaced as it grows.
+		 **************************************************************************************************/
+		std::atomic<STIndex *> _HashTable;
+
+
+		/**************************************************************************************************
+		 * @brief	The chunks.
+		 *
+		 * ### summary	@brief	Directory of the blocks of string storage, indexed by the high bits of a
+		 * 			string number.  Replaced by a larger copy when it fills up.
+		 **************************************************************************************************/
+		std::atomic<char **> _Chunks;
+		std::atomic<unsigned int> _NumChunks;
+		unsigned int _ChunkCapacity;
+
+
+		/**************************************************************************************************
+		 * @brief	The chunk sizes.
+		 *
+		 * ### summary	@brief	Bytes allocated for each chunk, guarded by the storage lock.
 		 **************************************************************************************************/
-		unsigned int _HTNumKeys;
+		std::vector<size_t> _ChunkSizes;
 
 
 		/**************************************************************************************************
-		 * @brief	Number of height overflows.
+		 * @brief	The mapped chunks.
 		 *
-		 * ### summary	@brief	Number of overflow blocks allocated.
+		 * ### summary	@brief	Number of leading chunks which live in the file mapping rather than the
+		 * 			heap.
 		 **************************************************************************************************/
-		unsigned int _HTOverflowCnt;
+		unsigned int _NumMappedChunks;
+
+
+		/** @brief	The file mapping set up by Map_Table, NULL if there is none. */
+		void *_MapBase;
+		size_t _MapSize;
 
 
 		/**************************************************************************************************
-		 * @brief	The height overflow position.
+		 * @brief	The chunk shift.
 		 *
-		 * ### summary	@brief	The current location in the current overflow block.
+		 * ### summary	@brief	Log2 of the chunk size, the number of offset bits in a string number.
 		 **************************************************************************************************/
-		unsigned int _HTOverflowPos;
+		unsigned int _ChunkShift;
 
 
 		/**************************************************************************************************
-		 * @brief	The height overflow.
+		 * @brief	The current index.
 		 *
-		 * ### summary	@brief	Collection of overflow blocks.
+		 * ### summary	@brief	Chunk new strings are added to in the high 32 bits and the offset for
+		 * 			the next string in it in the low 32 bits.  Strings too long for a chunk get one of
+		 * 			their own.
 		 **************************************************************************************************/
-		std::vector<STNode *> _HTOverflow;
+		std::atomic<uint64_t> _STCurrentIndex;
+
+
+		/**************************************************************************************************
+		 * @brief	Size of the table.
+		 *
+		 * ### summary	@brief	Bytes of string storage allocated.
+		 **************************************************************************************************/
+		std::atomic<size_t> _STTableSize;
+
+
+		/**************************************************************************************************
+		 * @brief	The height number keys.
+		 *
+		 * ### summary	@brief	The number of strings in the hash table.
+		 **************************************************************************************************/
+		std::atomic<unsigned int> _HTNumKeys;
+
+
+		/** @brief	True if the table is shared between threads, otherwise no locks are taken. */
+		bool _Concurrent;
+
+
+		/** @brief	Guards adding chunks. */
+		std::mutex _StorageLock;
+
+
+		/** @brief	Locks serializing the addition of strings with the same low hash bits. */
+		STStripe _Stripes[ST_NUM_STRIPES];
+
 
+		/** @brief	Indexes and chunk directories replaced by growth, freed with the table. */
+		std::vector<STIndex *> _RetiredIndex;
+		std::vector<char **> _RetiredChunks;
 	};
 
 
@@ -12,17 +12,48 @@
 #endif
 
 #include <type_traits> 
+#include <algorithm>
+#include <utility>
+#ifdef PSTD_POOL_DEBUG
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
 #include "pmath.h"
+#include "PBlockSource.hpp"
+#include "PPoolStats.hpp"
+#include "PCacheLine.hpp"
+
+#ifdef PSTD_POOL_DEBUG
+#define PMM_GUARD_SIZE        8              // bytes of canary on each side of a chunk's object
+#define PMM_GUARD_BYTE        0xFD           // canary fill
+#define PMM_POISON_BYTE       0xDD           // fill for the object area of free chunks
+#define PMM_CHUNK_FREE        0xF4EEF4EE     // chunk state word values
+#define PMM_CHUNK_ALLOCATED   0xA110CA7E
+#endif
 
 namespace PSTD {
 
+   /** \brief How a pool decides the size of each new block when it grows */
+   enum PMMGrowthPolicy {
+      PMM_GROW_FIXED,            /*!< Every block holds the initial object count */
+      PMM_GROW_DOUBLE,           /*!< Each block holds twice as many objects as the previous one */
+      PMM_GROW_CAPPED_DOUBLE     /*!< Doubling until a block reaches the configured maximum object count */
+   };
+
    
    /** \brief Pooled memory manager
     *
     * A class used to handle the quick allocation of fix size memory chunks initializing additional memory as needed
+    *
+    * Defining PSTD_POOL_DEBUG turns on a checked mode where each chunk's object is surrounded by canaries, the
+    * front one holding a state word marking the chunk allocated or free, and free chunks are poisoned.  Double
+    * frees, frees of pointers that don't belong to the pool, buffer over/underruns and writes to freed objects are
+    * then reported (and the process aborted) at the point they are detected.
     * \tparam T Type of object to manage
+    * \tparam BlockSource Where the pool gets its blocks of raw memory from (see PBlockSource.hpp)
     */
-   template <typename T>
+   template <typename T, typename BlockSource = PNewBlockSource>
       class PoolMemManager {
 
         public:
@@ -30,46 +61,46 @@ namespace PSTD {
       /** \brief Constructor
        * @param initialObjCnt The initial size of the pool
        * @param growPool Flag indicating if the pool should grow if it runs out of memory
+       * @param blockSource Source of the raw memory blocks used by the pool
        */
-          PoolMemManager(int initialObjCnt, bool growPool = false) :
-         _GrowPool(growPool)
+          PoolMemManager(int initialObjCnt, bool growPool = false, const BlockSource &blockSource = BlockSource()) :
+         _GrowPool(growPool),
+         _BlockSource(blockSource)
          {
+            Init_Pool(initialObjCnt, 0);
+         };
 
-			int typeAlignment = std::alignment_of<T>::value;
-            int typeSize = sizeof(T);
-            int charPtrAlignment = std::alignment_of<char *>::value;
-            int charPtrSize = sizeof(char *);
-            
-            std::vector<unsigned int> memSizes;
-            memSizes.push_back(typeAlignment);
-            memSizes.push_back(typeSize);
-            memSizes.push_back(charPtrAlignment);
-            memSizes.push_back(charPtrSize);
-
-            // initialize the pool values and allocate the first block of memory used for pooling
-            _ObjPerBlock = initialObjCnt;
-            _ChunkSize = PSTD::PMath::LCM(memSizes);
-            _NumFreeObj = _ObjPerBlock;
-            _NumAllocatedObj = 0;
-         
-            char *block = new char[(_ObjPerBlock + 1) * _ChunkSize];
-            _BlockList.push_back(block); 
-
-            // compute the point where we should start in the buffer so that memory is aligned
-             unsigned int offset = Get_AlignmentOffset(block);
-            _AlignedBlock.push_back(&block[offset]);
 
-            // link all nodes together
-            Init_Memory(0);
-            _HeadIndex = _AlignedBlock[0];
+      /** \brief Constructor for pools whose chunks are padded out and aligned to a given boundary
+       *
+       * Aligning chunks to PSTD_CACHELINE_SIZE keeps objects handed to different threads from false sharing
+       * @param initialObjCnt The initial size of the pool
+       * @param growPool Flag indicating if the pool should grow if it runs out of memory
+       * @param chunkAlign Alignment (power of two) of every chunk, e.g. PSTD_CACHELINE_SIZE
+       * @param blockSource Source of the raw memory blocks used by the pool
+       */
+          PoolMemManager(int initialObjCnt, bool growPool, unsigned int chunkAlign, const BlockSource &blockSource = BlockSource()) :
+         _GrowPool(growPool),
+         _BlockSource(blockSource)
+         {
+            Init_Pool(initialObjCnt, chunkAlign);
          };
 
      
       //! Deconstructor
          ~PoolMemManager(void) {
             for (unsigned int i = 0; i < _BlockList.size(); i++) {
-               delete []_BlockList[i];
+               _BlockSource.Free_Block(_BlockList[i], Get_BlockBytes(_BlockObjCnt[i]));
             }
+            PMM_STAT(PPoolRegistry::Unregister(&_Stats));
+         };
+
+
+         /** \brief Set the name the pool is reported under when PSTD_POOL_STATS is defined
+          * @param name Pool name
+          */
+         void Set_Name(const char *name) {
+            PMM_STAT(PPoolRegistry::Rename(&_Stats, name));
          };
 
 		 /**  Get the size of the chunks used for the object
@@ -79,27 +110,36 @@ namespace PSTD {
 
 
          /** Allocate an object out of the pool
+          * @param args Arguments forwarded to the object's constructor
           * @return Allocated object
           */
-         T *Allocate_Object(void) {
+         template <typename... Args>
+         T *Allocate_Object(Args &&... args) {
             char *nextObj;
             
             // if we are out of objects in the pool, check if we should create a new block
             if (_HeadIndex == NULL) {
                if (!_GrowPool) {
+                  PMM_STAT(_Stats.On_Failed(1));
                   return NULL;
                }
              
-               nextObj = Add_Block();
-            }
-            else {
-               nextObj = *((char **)_HeadIndex);
+               _HeadIndex = Add_Block(_NextObjPerBlock);
+               if (_HeadIndex == NULL) {
+                  PMM_STAT(_Stats.On_Failed(1));
+                  return NULL;
+               }
             }
+            nextObj = *((char **)_HeadIndex);
 
             // then create our object in the pool's memory
-            T *obj = new (_HeadIndex) T();
+#ifdef PSTD_POOL_DEBUG
+            Guard_CheckAllocate(_HeadIndex);
+#endif
+            T *obj = new (_HeadIndex) T(std::forward<Args>(args)...);
             _NumFreeObj--;
             _NumAllocatedObj++;
+            PMM_STAT(_Stats.On_Alloc(1));
 
             _HeadIndex = nextObj;
             return obj;
@@ -111,12 +151,69 @@ namespace PSTD {
        */
       void Free_Object(T *obj) {
          // the returned object is not the front of the free list and the it points to the old head
+#ifdef PSTD_POOL_DEBUG
+         Guard_CheckFree((char *)obj);
+#endif
          *(char **)obj = _HeadIndex;
             _HeadIndex = (char *)obj;
             _NumFreeObj++;
             _NumAllocatedObj--;
+            PMM_STAT(_Stats.On_Free(1));
          }
 
+
+      /** \brief Allocate a run of objects out of the pool
+       * @param out Array receiving the allocated objects
+       * @param n Number of objects to allocate
+       * @return Number of objects allocated, less than n only if the pool ran out of memory
+       */
+      size_t Allocate_Bulk(T **out, size_t n) {
+         size_t cnt = Pop_Run(out, n);
+         for (size_t i = 0; i < cnt; i++) {
+            new (out[i]) T();
+         }
+         return cnt;
+      };
+
+
+      /** \brief Allocate a run of objects out of the pool without constructing them
+       *
+       *  Only available for trivial types, the contents of the returned objects are undefined
+       * @param out Array receiving the allocated objects
+       * @param n Number of objects to allocate
+       * @return Number of objects allocated, less than n only if the pool ran out of memory
+       */
+      size_t Allocate_BulkNoInit(T **out, size_t n) {
+         static_assert(std::is_trivial<T>::value, "Allocate_BulkNoInit requires a trivial type");
+         return Pop_Run(out, n);
+      };
+
+
+      /** \brief Return a run of objects back to the pool
+       * @param objs Objects to return
+       * @param n Number of objects
+       */
+      void Free_Bulk(T **objs, size_t n) {
+         if (!n) {
+            return;
+         }
+
+         // chain the objects together and splice the chain onto the front of the free list
+#ifdef PSTD_POOL_DEBUG
+         for (size_t i = 0; i < n; i++) {
+            Guard_CheckFree((char *)objs[i]);
+         }
+#endif
+         for (size_t i = 0; i < n - 1; i++) {
+            *(char **)objs[i] = (char *)objs[i + 1];
+         }
+         *(char **)objs[n - 1] = _HeadIndex;
+         _HeadIndex = (char *)objs[0];
+         _NumFreeObj += (unsigned int)n;
+         _NumAllocatedObj -= (unsigned int)n;
+         PMM_STAT(_Stats.On_Free(n));
+      };
+
                 
       /** \brief Reset pool to initialized state 
        *
@@ -130,26 +227,248 @@ namespace PSTD {
             }
             
             // and link the blocks together
+            _NumFreeObj = _BlockObjCnt.back();
             for (unsigned int i = 0; i < _BlockList.size() - 1; i++) {
-               char *blockALastPtr =  &(_AlignedBlock[i][(_ObjPerBlock - 1) * _ChunkSize]);         
+               char *blockALastPtr =  &(_AlignedBlock[i][(_BlockObjCnt[i] - 1) * _ChunkSize]);         
                char *blockBFirstPtr = _AlignedBlock[i + 1];         
                *(char **)(blockALastPtr) = blockBFirstPtr;
+               _NumFreeObj += _BlockObjCnt[i];
             }
 
-            _NumFreeObj = _ObjPerBlock * _BlockList.size();
+            _HeadIndex = _AlignedBlock[0];
             _NumAllocatedObj = 0;
+            PMM_STAT(_Stats.On_FreeAll());
          };
 
+
+      /** \brief Set how the pool sizes new blocks when it grows
+       * @param policy Growth policy
+       * @param maxObjPerBlock Largest block (in objects) used by PMM_GROW_CAPPED_DOUBLE
+       */
+      void Set_GrowthPolicy(PMMGrowthPolicy policy, unsigned int maxObjPerBlock = 0) {
+         _GrowthPolicy = policy;
+         _MaxObjPerBlock = maxObjPerBlock;
+         _NextObjPerBlock = (policy == PMM_GROW_FIXED) ? _ObjPerBlock : Get_GrownBlockSize(_BlockObjCnt.back());
+      };
+
+
+      /** \brief Release blocks in which every object is free
+       *
+       *  Occupancy is worked out by walking the free list here rather than tracked on every allocate and free, so
+       *  the cost is only paid when trimming.  At least one block is always kept.
+       *  @return Number of blocks released
+       */
+      unsigned int Trim(void) {
+         size_t numBlocks = _BlockList.size();
+
+         // block indices sorted by address so a chunk's block can be found with a binary search
+         std::vector<unsigned int> sorted(numBlocks);
+         for (unsigned int i = 0; i < numBlocks; i++) {
+            sorted[i] = i;
+         }
+         std::sort(sorted.begin(), sorted.end(), BlockAddrCmp(_AlignedBlock));
+
+         // count the free chunks in each block
+         std::vector<unsigned int> freeCnt(numBlocks, 0);
+         for (char *chunk = _HeadIndex; chunk; chunk = *(char **)chunk) {
+            freeCnt[Find_Block(sorted, chunk)]++;
+         }
+
+         std::vector<bool> release(numBlocks, false);
+         unsigned int numRelease = 0;
+         for (unsigned int i = 0; i < numBlocks; i++) {
+            if (freeCnt[i] == _BlockObjCnt[i]) {
+               release[i] = true;
+               numRelease++;
+            }
+         }
+         if (numRelease == numBlocks) {
+            release[0] = false;
+            numRelease--;
+         }
+         if (!numRelease) {
+            return 0;
+         }
+
+         // unlink the chunks of released blocks from the free list, keeping the order of the rest
+         char **link = &_HeadIndex;
+         for (char *chunk = _HeadIndex; chunk; chunk = *(char **)chunk) {
+            if (!release[Find_Block(sorted, chunk)]) {
+               *link = chunk;
+               link = (char **)chunk;
+            }
+         }
+         *link = NULL;
+
+         // and hand the blocks back to the block source
+         unsigned int keep = 0;
+         for (unsigned int i = 0; i < numBlocks; i++) {
+            if (release[i]) {
+               _BlockSource.Free_Block(_BlockList[i], Get_BlockBytes(_BlockObjCnt[i]));
+               _NumFreeObj -= _BlockObjCnt[i];
+               PMM_STAT(_Stats.On_ReleaseBlock(_BlockObjCnt[i]));
+            }
+            else {
+               _BlockList[keep] = _BlockList[i];
+               _AlignedBlock[keep] = _AlignedBlock[i];
+               _BlockObjCnt[keep] = _BlockObjCnt[i];
+               keep++;
+            }
+         }
+         _BlockList.resize(keep);
+         _AlignedBlock.resize(keep);
+         _BlockObjCnt.resize(keep);
+         return numRelease;
+      };
+
+
+      /** \brief Get the number of blocks currently held by the pool
+       * @return Number of blocks
+       */
+      unsigned int Get_NumBlocks(void) { return (unsigned int)_BlockList.size(); };
+
       /** \brief Get the number of free objects remaining in the pool
        * @return Number of free objects remaining
        */
       unsigned int Get_NumFreeObj(void) { return _NumFreeObj; };
 
+      /** \brief Get the block source the pool takes its memory from
+       * @return Block source
+       */
+      const BlockSource &Get_BlockSource(void) { return _BlockSource; };
+
    private:
+         // set up the chunk layout and allocate the first block of memory used for pooling
+         void Init_Pool(int initialObjCnt, unsigned int chunkAlign) {
+			int typeAlignment = std::alignment_of<T>::value;
+            int typeSize = sizeof(T);
+#ifdef PSTD_POOL_DEBUG
+            // the chunk also holds the guards, and is rounded up so it stays a multiple of the alignment
+            typeSize = _GuardFront + ((sizeof(T) > sizeof(char *)) ? sizeof(T) : sizeof(char *)) + PMM_GUARD_SIZE;
+            unsigned int guardAlign = (typeAlignment > (int)std::alignment_of<char *>::value) ? typeAlignment : std::alignment_of<char *>::value;
+            typeSize = (typeSize + guardAlign - 1) & ~(guardAlign - 1);
+#endif
+            int charPtrAlignment = std::alignment_of<char *>::value;
+            int charPtrSize = sizeof(char *);
+            
+            std::vector<unsigned int> memSizes;
+            memSizes.push_back(typeAlignment);
+            memSizes.push_back(typeSize);
+            memSizes.push_back(charPtrAlignment);
+            memSizes.push_back(charPtrSize);
+            _ChunkAlign = (typeAlignment > charPtrAlignment) ? typeAlignment : charPtrAlignment;
+            if (chunkAlign > _ChunkAlign) {
+               _ChunkAlign = chunkAlign;
+            }
+
+            // initialize the pool values and allocate the first block of memory used for pooling
+            _ObjPerBlock = initialObjCnt;
+            _ChunkSize = PSTD::PMath::LCM(memSizes);
+
+            // padding to the chunk alignment rather than taking the LCM with it keeps e.g. a 24 byte object in 64 bytes, not 192
+            if (chunkAlign) {
+               _ChunkSize = (_ChunkSize + chunkAlign - 1) & ~(chunkAlign - 1);
+            }
+            _GrowthPolicy = PMM_GROW_FIXED;
+            _MaxObjPerBlock = 0;
+            _NextObjPerBlock = _ObjPerBlock;
+            _NumFreeObj = 0;
+            _NumAllocatedObj = 0;
+         
+            PMM_STAT(_Stats._ChunkSize = _ChunkSize);
+            PMM_STAT(PPoolRegistry::Register(&_Stats));
+
+            // link all nodes together
+            _HeadIndex = Add_Block(_ObjPerBlock);
+         };
+
+
+         // pop up to n chunks off the free list, growing the pool if allowed
+         size_t Pop_Run(T **out, size_t n) {
+            size_t cnt = 0;
+            while (cnt < n) {
+               if (_HeadIndex == NULL) {
+                  if (!_GrowPool) {
+                     break;
+                  }
+                  _HeadIndex = Add_Block(_NextObjPerBlock);
+                  if (_HeadIndex == NULL) {
+                     break;
+                  }
+               }
+
+               char *chunk = _HeadIndex;
+               while (chunk && (cnt < n)) {
+#ifdef PSTD_POOL_DEBUG
+                  Guard_CheckAllocate(chunk);
+#endif
+                  out[cnt++] = (T *)chunk;
+                  chunk = *(char **)chunk;
+               }
+               _HeadIndex = chunk;
+            }
+
+            _NumFreeObj -= (unsigned int)cnt;
+            _NumAllocatedObj += (unsigned int)cnt;
+            PMM_STAT(_Stats.On_Alloc(cnt));
+            PMM_STAT(_Stats.On_Failed(cnt < n));
+            return cnt;
+         };
+
+
+         // orders block indices by the address of their aligned start
+         struct BlockAddrCmp {
+            const std::vector<char *> &_Blocks;
+            BlockAddrCmp(const std::vector<char *> &blocks) : _Blocks(blocks) {};
+            bool operator()(unsigned int a, unsigned int b) const { return _Blocks[a] < _Blocks[b]; };
+         };
+
+
+         // find the index of the block holding a chunk given the block indices sorted by address
+         unsigned int Find_Block(const std::vector<unsigned int> &sorted, char *chunk) {
+            size_t lo = 0;
+            size_t hi = sorted.size();
+            while (hi - lo > 1) {
+               size_t mid = (lo + hi) / 2;
+               if (_AlignedBlock[sorted[mid]] <= chunk) {
+                  lo = mid;
+               }
+               else {
+                  hi = mid;
+               }
+            }
+            return sorted[lo];
+         };
+
+
+         // bytes requested from the block source for a block of objCnt objects, including the alignment slack
+         size_t Get_BlockBytes(unsigned int objCnt) {
+            size_t bytes = (size_t)objCnt * _ChunkSize + _ChunkAlign - 1;
+#ifdef PSTD_POOL_DEBUG
+            bytes += _GuardFront;
+#endif
+            return bytes;
+         };
+
+
+         // size of the block following one holding objCnt objects under the current growth policy
+         unsigned int Get_GrownBlockSize(unsigned int objCnt) {
+            if (_GrowthPolicy == PMM_GROW_FIXED) {
+               return _ObjPerBlock;
+            }
+            unsigned int grown = objCnt * 2;
+            if ((_GrowthPolicy == PMM_GROW_CAPPED_DOUBLE) && _MaxObjPerBlock && (grown > _MaxObjPerBlock)) {
+               grown = _MaxObjPerBlock;
+            }
+            return (grown > objCnt) ? grown : objCnt;
+         };
+
+
          // determine the offset from the start of a given memory block necessary to make sure the object is properly aligned
+         //   (the chunk size is a multiple of the chunk alignment so every chunk in the block ends up aligned)
          unsigned int Get_AlignmentOffset(char *block) {
             int offset = 0;
-            while (((uintptr_t)(&block[offset])) & (_ChunkSize - 1)) {
+            while (((uintptr_t)(&block[offset])) & (_ChunkAlign - 1)) {
                offset++;
             }
             return offset;
@@ -164,38 +483,147 @@ namespace PSTD {
             char *blockBStart = NULL;
 
             // interleave pointers to the next object in memory
-            for (unsigned int i = 0; i < _ObjPerBlock - 1; i++) {
+            unsigned int objCnt = _BlockObjCnt[block];
+            for (unsigned int i = 0; i < objCnt - 1; i++) {
                *(char **)(&blockAStart[i * _ChunkSize]) = &blockAStart[(i + 1) * _ChunkSize];
             }
-            *(char **)(&blockAStart[_ChunkSize * (_ObjPerBlock - 1)]) = blockBStart;
+            *(char **)(&blockAStart[_ChunkSize * (objCnt - 1)]) = blockBStart;
+
+#ifdef PSTD_POOL_DEBUG
+            for (unsigned int i = 0; i < objCnt; i++) {
+               Guard_Init(&blockAStart[i * _ChunkSize]);
+            }
+#endif
+         };
+
+
+#ifdef PSTD_POOL_DEBUG
+         // size of the object area between the guards, big enough for the free list link
+         size_t Get_ObjSpan(void) { return (sizeof(T) > sizeof(char *)) ? sizeof(T) : sizeof(char *); };
+
+
+         // report a detected corruption and stop
+         void Guard_Fail(const char *msg, char *obj) {
+            fprintf(stderr, "PoolMemManager: %s (object %p, chunk size %u)\n", msg, (void *)obj, _ChunkSize);
+            abort();
+         };
+
+
+         // mark a chunk free, lay down its canaries and poison its object area (the free list link is kept)
+         void Guard_Init(char *obj) {
+            *(uint32_t *)(obj - _GuardFront) = PMM_CHUNK_FREE;
+            memset(obj - _GuardFront + sizeof(uint32_t), PMM_GUARD_BYTE, _GuardFront - sizeof(uint32_t));
+            memset(obj + sizeof(char *), PMM_POISON_BYTE, Get_ObjSpan() - sizeof(char *));
+            memset(obj + Get_ObjSpan(), PMM_GUARD_BYTE, PMM_GUARD_SIZE);
+         };
+
+
+         // check the canaries on both sides of an object
+         bool Guard_Intact(char *obj) {
+            for (unsigned int i = sizeof(uint32_t); i < _GuardFront; i++) {
+               if ((unsigned char)(obj - _GuardFront)[i] != PMM_GUARD_BYTE) return false;
+            }
+            for (unsigned int i = 0; i < PMM_GUARD_SIZE; i++) {
+               if ((unsigned char)obj[Get_ObjSpan() + i] != PMM_GUARD_BYTE) return false;
+            }
+            return true;
          };
 
 
+         // make sure a chunk about to be handed out is free and untouched since it was freed
+         void Guard_CheckAllocate(char *obj) {
+            if (*(uint32_t *)(obj - _GuardFront) != PMM_CHUNK_FREE) {
+               Guard_Fail("free list corrupted, chunk on the free list is not marked free", obj);
+            }
+            for (size_t i = sizeof(char *); i < Get_ObjSpan(); i++) {
+               if ((unsigned char)obj[i] != PMM_POISON_BYTE) {
+                  Guard_Fail("freed object was written to after it was freed", obj);
+               }
+            }
+            if (!Guard_Intact(obj)) {
+               Guard_Fail("guard corrupted while the chunk was free", obj);
+            }
+            *(uint32_t *)(obj - _GuardFront) = PMM_CHUNK_ALLOCATED;
+         };
+
+
+         // make sure a pointer being freed is a live object from this pool and poison it
+         void Guard_CheckFree(char *obj) {
+            bool owned = false;
+            for (size_t i = 0; (i < _AlignedBlock.size()) && !owned; i++) {
+               if ((obj >= _AlignedBlock[i]) && (obj < _AlignedBlock[i] + (size_t)_BlockObjCnt[i] * _ChunkSize)) {
+                  if ((size_t)(obj - _AlignedBlock[i]) % _ChunkSize) {
+                     Guard_Fail("freed pointer is not the start of an object", obj);
+                  }
+                  owned = true;
+               }
+            }
+            if (!owned) {
+               Guard_Fail("freed pointer does not belong to this pool", obj);
+            }
+
+            uint32_t state = *(uint32_t *)(obj - _GuardFront);
+            if (state == PMM_CHUNK_FREE) {
+               Guard_Fail("double free", obj);
+            }
+            if ((state != PMM_CHUNK_ALLOCATED) || !Guard_Intact(obj)) {
+               Guard_Fail("guard corrupted, buffer overrun or underrun", obj);
+            }
+
+            *(uint32_t *)(obj - _GuardFront) = PMM_CHUNK_FREE;
+            memset(obj + sizeof(char *), PMM_POISON_BYTE, Get_ObjSpan() - sizeof(char *));
+         };
+#endif
+
+
          
-         // grow the pool by another block of memory capable of holding _ObjPerBlock onjects
-        char *Add_Block(void) {
-            char *block = new char[_ObjPerBlock * (_ChunkSize + 1)];
+         // grow the pool by another block of memory capable of holding objCnt onjects
+        char *Add_Block(unsigned int objCnt) {
+            char *block = _BlockSource.Allocate_Block(Get_BlockBytes(objCnt));
+            if (!block) {
+               return NULL;
+            }
+            PMM_STAT(_Stats.On_AddBlock(objCnt, !_BlockList.empty()));
             _BlockList.push_back(block); 
+            _BlockObjCnt.push_back(objCnt);
             
             // compute the point where we should start in the buffer so that memory is aligned
             unsigned int offset = Get_AlignmentOffset(block);
+#ifdef PSTD_POOL_DEBUG
+            // objects start after the front guard so the free list and block bookkeeping keep using object addresses
+            offset += _GuardFront;
+#endif
             _AlignedBlock.push_back(&block[offset]);
 
             Init_Memory(_BlockList.size() - 1);
+            _NumFreeObj += objCnt;
+            _NextObjPerBlock = Get_GrownBlockSize(objCnt);
             return &block[offset];
          };                          
 
          // +ECM+
+#ifdef PSTD_POOL_DEBUG
+      enum { _GuardFront = (std::alignment_of<T>::value > PMM_GUARD_SIZE) ? std::alignment_of<T>::value : PMM_GUARD_SIZE };
+#endif
       bool _GrowPool;                     /*!< Flag indicating if memory pool should grow when it runs out of free chunks */
       
          unsigned int _NumAllocatedObj;
          unsigned int _NumFreeObj;           // +CV+ _FreeObj (unsigned int): Number of free memory chunks ]
-         unsigned int _ObjPerBlock;          // +CV+ _ObjPerBlock (unsigned int): Number of pooled objects per block ]
+         unsigned int _ObjPerBlock;          // +CV+ _ObjPerBlock (unsigned int): Number of pooled objects in the initial block ]
+         unsigned int _NextObjPerBlock;      // +CV+ _NextObjPerBlock (unsigned int): Number of pooled objects in the next block added ]
+         unsigned int _MaxObjPerBlock;       // +CV+ _MaxObjPerBlock (unsigned int): Block size cap for PMM_GROW_CAPPED_DOUBLE ]
+         PMMGrowthPolicy _GrowthPolicy;      // +CV+ _GrowthPolicy (PMMGrowthPolicy): How new blocks are sized ]
+         unsigned int _ChunkAlign;           // +CV+ _ChunkAlign (unsigned int): Alignment of the first chunk in each block ]
          unsigned int _ChunkSize;              // +CV+ _ChunkSize (unsigned int): Size of the properly aligned chunk of memory necessary 
                                              //                               to hold our object and pointer to the next available object ]
+         BlockSource _BlockSource;           // +CV+ _BlockSource (BlockSource): Where blocks of raw memory come from ]
          std::vector<char *> _BlockList;     // +CV+ _BlockList (vector<char *>): The collection of memory blooks used to allocate object ]
          std::vector<char *> _AlignedBlock;  // +CV+ _BlockStart (vector<char *>): The address of the start of the block so that objects are properly alligned in memory ]
+         std::vector<unsigned int> _BlockObjCnt; // +CV+ _BlockObjCnt (vector<unsigned int>): Number of objects held by each block ]
          char *_HeadIndex;                   // +CV+ Head_Index (unsigned char *): The next available chunk ]
+#ifdef PSTD_POOL_STATS
+         PPoolStats _Stats;                  // +CV+ _Stats (PPoolStats): Allocation counters reported through PPoolRegistry ]
+#endif
    };
 
    // +EndClass+ Pool_MemManager
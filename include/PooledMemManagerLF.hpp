@@ -0,0 +1,220 @@
+/** \file PooledMemManagerLF.hpp
+ *  \brief A lock free pooled memory manager
+ *
+ * Variant of the pooled memory manager whose free list is a lock free (Treiber) stack, for pools where objects
+ * are allocated on one thread and freed on another.
+ */
+
+#ifndef POOL_MEMMANAGER_LF_H
+#define POOL_MEMMANAGER_LF_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+
+#define PMM_LF_MAX_BLOCKS		1024			// default maximum number of blocks a lock free pool may grow to
+#define PMM_LF_EMPTY			0xFFFFFFFF		// chunk index marking the end of the free list
+
+namespace PSTD {
+
+
+	/** \brief Lock free pooled memory manager
+	 *
+	 * Chunks are addressed by a 32 bit index and the free list head packs that index with a 32 bit modification
+	 * tag which is bumped on every update, so a single 64 bit CAS on the head is safe from the ABA problem.  Each
+	 * chunk carries its own index and its free list link in a small header in front of the object, so frees don't
+	 * have to search for the owning block and a pop reading the link of a chunk another thread has just taken
+	 * never touches object memory the new owner may be writing.  The block table has a fixed capacity so growing the pool never moves memory that
+	 * other threads may be reading.
+	 * \tparam T Type of object to manage
+	 */
+	template <typename T>
+	class PoolMemManagerLF {
+
+		public:
+
+		/** \brief Constructor
+		 * @param initialObjCnt The initial size of the pool, rounded up to a power of two and used as the block size
+		 * @param growPool Flag indicating if the pool should grow if it runs out of memory
+		 * @param maxBlocks Maximum number of blocks the pool may grow to
+		 */
+		PoolMemManagerLF(unsigned int initialObjCnt, bool growPool = false, unsigned int maxBlocks = PMM_LF_MAX_BLOCKS) :
+			_GrowPool(growPool),
+			_MaxBlocks(maxBlocks),
+			_NumBlocks(0),
+			_Head(PMM_LF_EMPTY)
+		{
+			// blocks hold a power of two number of objects so a chunk index splits into block and offset with shifts
+			_BlockShift = 0;
+			while ((1u << _BlockShift) < initialObjCnt) {
+				_BlockShift++;
+			}
+			_ObjPerBlock = 1u << _BlockShift;
+
+			// the chunk header holds the chunk's index and free list link, the object follows it at the first
+			//   properly aligned offset
+			unsigned int typeAlignment = std::alignment_of<T>::value;
+			_ObjOffset = (typeAlignment > 2 * sizeof(uint32_t)) ? typeAlignment : 2 * sizeof(uint32_t);
+
+			// chunks are padded so every header and object stays aligned, both alignments are powers of two
+			unsigned int chunkAlign = (typeAlignment > std::alignment_of<uint32_t>::value) ? typeAlignment : std::alignment_of<uint32_t>::value;
+			_ChunkSize = (_ObjOffset + sizeof(T) + chunkAlign - 1) & ~(chunkAlign - 1);
+
+			_BlockTable = new std::atomic<char *>[_MaxBlocks];
+			for (unsigned int i = 0; i < _MaxBlocks; i++) {
+				_BlockTable[i].store(NULL, std::memory_order_relaxed);
+			}
+
+			std::lock_guard<std::mutex> lock(_GrowLock);
+			Add_Block();
+		};
+
+
+		//! Deconstructor
+		~PoolMemManagerLF(void) {
+			for (unsigned int i = 0; i < _BlockList.size(); i++) {
+				delete[]_BlockList[i];
+			}
+			delete[]_BlockTable;
+		};
+
+
+		/**  Get the size of the chunks used for the object
+		 *   @return Chunk size
+		 */
+		unsigned int Get_ChunkSize(void) { return _ChunkSize; };
+
+
+		/**  Get the total number of objects the pool can currently hold
+		 *   @return Number of chunks in all blocks
+		 */
+		unsigned int Get_Capacity(void) { return _NumBlocks.load(std::memory_order_acquire) * _ObjPerBlock; };
+
+
+		/** Allocate an object out of the pool, may be called concurrently from any thread
+		 * @return Allocated object or NULL if the pool is exhausted and can not grow
+		 */
+		T *Allocate_Object(void) {
+			uint64_t head = _Head.load(std::memory_order_acquire);
+
+			for (;;) {
+				uint32_t index = (uint32_t)head;
+
+				// out of chunks so grow the pool and try again
+				if (index == PMM_LF_EMPTY) {
+					if (!_GrowPool) {
+						return NULL;
+					}
+					{
+						std::lock_guard<std::mutex> lock(_GrowLock);
+						if ((uint32_t)_Head.load(std::memory_order_acquire) == PMM_LF_EMPTY) {
+							if (!Add_Block()) {
+								return NULL;
+							}
+						}
+					}
+					head = _Head.load(std::memory_order_acquire);
+					continue;
+				}
+
+				// the chunk may already have been popped and reused by another thread, in which case the next
+				//   index read here is stale but the tag makes the CAS below fail
+				char *chunk = Get_Chunk(index);
+				uint32_t next = Get_NextIndex(chunk)->load(std::memory_order_relaxed);
+				uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+				if (_Head.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+					return new (chunk + _ObjOffset) T();
+				}
+			}
+		};
+
+
+		/** \brief Return an object back to the pool, may be called concurrently from any thread
+		 * @param obj Object to return
+		 */
+		void Free_Object(T *obj) {
+			char *chunk = (char *)obj - _ObjOffset;
+			Push_Chain(chunk, *(uint32_t *)chunk);
+		};
+
+		private:
+
+		// get the chunk with the given index
+		char *Get_Chunk(uint32_t index) {
+			return _BlockTable[index >> _BlockShift].load(std::memory_order_acquire) + (index & (_ObjPerBlock - 1)) * _ChunkSize;
+		};
+
+
+		// get the free list link stored in the chunk header after the index
+		std::atomic<uint32_t> *Get_NextIndex(char *chunk) {
+			return (std::atomic<uint32_t> *)(chunk + sizeof(uint32_t));
+		};
+
+
+		// push an already linked run of chunks, starting at the chunk with index firstIndex and ending at last, onto the free list
+		void Push_Chain(char *last, uint32_t firstIndex) {
+			uint64_t head = _Head.load(std::memory_order_relaxed);
+			do {
+				Get_NextIndex(last)->store((uint32_t)head, std::memory_order_relaxed);
+			} while (!_Head.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | firstIndex, std::memory_order_release, std::memory_order_relaxed));
+		};
+
+
+		// grow the pool by another block of memory capable of holding _ObjPerBlock objects (_GrowLock must be held)
+		bool Add_Block(void) {
+			unsigned int blockNum = _NumBlocks.load(std::memory_order_relaxed);
+			if (blockNum == _MaxBlocks) {
+				return false;
+			}
+
+			char *block = new (std::nothrow) char[(_ObjPerBlock + 1) * _ChunkSize];
+			if (!block) {
+				return false;
+			}
+			_BlockList.push_back(block);
+
+			// compute the point where we should start in the buffer so that memory is aligned
+			char *start = block;
+			while (((uintptr_t)start) & (std::alignment_of<T>::value - 1)) {
+				start++;
+			}
+
+			// stamp each chunk with its index and link them all together
+			uint32_t baseIndex = blockNum << _BlockShift;
+			for (unsigned int i = 0; i < _ObjPerBlock; i++) {
+				char *chunk = &start[i * _ChunkSize];
+				*(uint32_t *)chunk = baseIndex + i;
+				new (chunk + sizeof(uint32_t)) std::atomic<uint32_t>(baseIndex + i + 1);
+			}
+
+			// publish the block before any of its chunks become reachable from the free list
+			_BlockTable[blockNum].store(start, std::memory_order_release);
+			_NumBlocks.store(blockNum + 1, std::memory_order_release);
+			Push_Chain(&start[(_ObjPerBlock - 1) * _ChunkSize], baseIndex);
+			return true;
+		};
+
+
+		bool _GrowPool;								/*!< Flag indicating if memory pool should grow when it runs out of free chunks */
+		unsigned int _ObjPerBlock;					// Number of pooled objects per block (power of two)
+		unsigned int _BlockShift;					// log2 of _ObjPerBlock
+		unsigned int _ChunkSize;					// Size of a chunk including the index and link header
+		unsigned int _ObjOffset;					// Offset of the object from the start of its chunk
+		unsigned int _MaxBlocks;					// Capacity of the block table
+
+		std::atomic<char *> *_BlockTable;			// Aligned start of each block indexed by block number
+		std::atomic<unsigned int> _NumBlocks;		// Number of blocks published in the block table
+		std::atomic<uint64_t> _Head;				// Tag (high 32 bits) and index (low 32 bits) of the next available chunk
+
+		std::mutex _GrowLock;						// Serializes pool growth
+		std::vector<char *> _BlockList;				// The collection of memory blocks used to allocate objects
+	};
+
+}
+
+
+#endif
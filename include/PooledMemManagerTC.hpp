@@ -0,0 +1,295 @@
+/** \file PooledMemManagerTC.hpp
+ *  \brief A thread caching pooled memory manager
+ *
+ * Concurrent variant of the pooled memory manager.  Each thread keeps a small magazine of free chunks so the
+ * common allocate/free path touches no shared memory, and whole batches of chunks are exchanged with a shared
+ * depot when a magazine runs empty or fills up.
+ */
+
+#ifndef POOL_MEMMANAGER_TC_H
+#define POOL_MEMMANAGER_TC_H
+
+#include <stdint.h>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <type_traits>
+#include "PCacheLine.hpp"
+
+
+#define PMM_TC_MAX_THREADS		64		// number of threads which get their own magazine, any others go straight to the depot
+#define PMM_TC_BATCH_SIZE		32		// default number of chunks moved between a magazine and the depot at a time
+
+namespace PSTD {
+
+
+	/** \brief Per thread slot registry
+	 *
+	 * Hands out a small process wide index for each thread.  The index of an exited thread is recycled so that
+	 * per thread state indexed by it stays bounded.
+	 */
+	class PThreadSlot {
+		public:
+
+		/** \brief Get the slot index of the calling thread
+		 * @return Slot index
+		 */
+		static unsigned int Get_Slot(void) {
+			static thread_local SlotHolder holder;
+			return holder._Slot;
+		};
+
+		private:
+		struct SlotHolder {
+			unsigned int _Slot;
+
+			SlotHolder(void) {
+				std::lock_guard<std::mutex> lock(Get_Lock());
+				std::vector<unsigned int> &freeSlots = Get_FreeSlots();
+				if (freeSlots.empty()) {
+					_Slot = Get_NextSlot()++;
+				}
+				else {
+					_Slot = freeSlots.back();
+					freeSlots.pop_back();
+				}
+			};
+
+			~SlotHolder(void) {
+				std::lock_guard<std::mutex> lock(Get_Lock());
+				Get_FreeSlots().push_back(_Slot);
+			};
+		};
+
+		static std::mutex &Get_Lock(void) { static std::mutex lock; return lock; };
+		static std::vector<unsigned int> &Get_FreeSlots(void) { static std::vector<unsigned int> slots; return slots; };
+		static unsigned int &Get_NextSlot(void) { static unsigned int next = 0; return next; };
+	};
+
+
+	/** \brief Thread caching pooled memory manager
+	 *
+	 * Objects may be allocated on one thread and freed on another.  A freed chunk goes into the magazine of the
+	 * freeing thread.
+	 * \tparam T Type of object to manage
+	 */
+	template <typename T>
+	class PoolMemManagerTC {
+
+		public:
+
+		/** \brief Constructor
+		 * @param initialObjCnt The initial size of the pool and the size it grows by, a pool of zero or fewer
+		 *                      objects hands out none
+		 * @param growPool Flag indicating if the pool should grow if it runs out of memory
+		 * @param batchSize Number of chunks exchanged between a thread's magazine and the shared depot at a time
+		 */
+		PoolMemManagerTC(int initialObjCnt, bool growPool = false, unsigned int batchSize = PMM_TC_BATCH_SIZE) :
+			_GrowPool(growPool),
+			_ObjPerBlock((initialObjCnt > 0) ? initialObjCnt : 0),
+			_BatchSize(batchSize ? batchSize : 1)
+		{
+			// a free chunk holds the link to the next one, chunks are padded so both stay aligned
+			unsigned int typeAlignment = std::alignment_of<T>::value;
+			unsigned int chunkAlign = (typeAlignment > std::alignment_of<char *>::value) ? typeAlignment : std::alignment_of<char *>::value;
+			unsigned int objSize = (sizeof(T) > sizeof(char *)) ? sizeof(T) : sizeof(char *);
+			_ChunkSize = (objSize + chunkAlign - 1) & ~(chunkAlign - 1);
+
+			// magazines are aligned to a cache line each so threads never false share them, new[] may not align them
+			_MagazineMem = new char[(PMM_TC_MAX_THREADS + 1) * sizeof(TCMagazine)];
+			char *magStart = _MagazineMem;
+			while (((uintptr_t)magStart) & (PSTD_CACHELINE_SIZE - 1)) {
+				magStart++;
+			}
+			_Magazines = new (magStart) TCMagazine[PMM_TC_MAX_THREADS];
+
+			Add_Block();
+		};
+
+
+		//! Deconstructor
+		~PoolMemManagerTC(void) {
+			for (unsigned int i = 0; i < _BlockList.size(); i++) {
+				delete[]_BlockList[i];
+			}
+			delete[]_MagazineMem;
+		};
+
+
+		/**  Get the size of the chunks used for the object
+		 *   @return Chunk size
+		 */
+		unsigned int Get_ChunkSize(void) { return _ChunkSize; };
+
+
+		/** Allocate an object out of the pool
+		 * @return Allocated object or NULL if the pool is exhausted and not allowed to grow
+		 */
+		T *Allocate_Object(void) {
+			unsigned int slot = PThreadSlot::Get_Slot();
+			char *chunk;
+
+			if (slot < PMM_TC_MAX_THREADS) {
+				TCMagazine &mag = _Magazines[slot];
+
+				// refill the loaded magazine from the previous one or, failing that, from the depot
+				if (!mag._Loaded._Count) {
+					if (mag._Previous._Count) {
+						TCBatch tmp = mag._Loaded;
+						mag._Loaded = mag._Previous;
+						mag._Previous = tmp;
+					}
+					else if (!Get_DepotBatch(mag._Loaded)) {
+						return NULL;
+					}
+				}
+				chunk = mag._Loaded._Head;
+				mag._Loaded._Head = *(char **)chunk;
+				mag._Loaded._Count--;
+			}
+
+			// threads without a magazine work directly against the depot
+			else {
+				std::lock_guard<std::mutex> lock(_DepotLock);
+				if (_Depot.empty() && (!_GrowPool || !Add_Block())) {
+					return NULL;
+				}
+				TCBatch &batch = _Depot.back();
+				chunk = batch._Head;
+				batch._Head = *(char **)chunk;
+				if (!--batch._Count) {
+					_Depot.pop_back();
+				}
+			}
+
+			return new (chunk) T();
+		};
+
+
+		/** \brief Return an object back to the pool
+		 * @param obj Object to return
+		 */
+		void Free_Object(T *obj) {
+			unsigned int slot = PThreadSlot::Get_Slot();
+			char *chunk = (char *)obj;
+
+			if (slot < PMM_TC_MAX_THREADS) {
+				TCMagazine &mag = _Magazines[slot];
+
+				// when the loaded magazine is full, swap it out and hand a full batch back to the depot if needed
+				if (mag._Loaded._Count == _BatchSize) {
+					if (mag._Previous._Count) {
+						std::lock_guard<std::mutex> lock(_DepotLock);
+						_Depot.push_back(mag._Previous);
+					}
+					mag._Previous = mag._Loaded;
+					mag._Loaded._Head = NULL;
+					mag._Loaded._Count = 0;
+				}
+				*(char **)chunk = mag._Loaded._Head;
+				mag._Loaded._Head = chunk;
+				mag._Loaded._Count++;
+			}
+			else {
+				std::lock_guard<std::mutex> lock(_DepotLock);
+				TCBatch batch;
+				*(char **)chunk = NULL;
+				batch._Head = chunk;
+				batch._Count = 1;
+				_Depot.push_back(batch);
+			}
+		};
+
+
+		/** \brief Get the number of free objects held by the shared depot (not counting thread magazines)
+		 * @return Number of free objects in the depot
+		 */
+		unsigned int Get_NumDepotObj(void) {
+			std::lock_guard<std::mutex> lock(_DepotLock);
+			unsigned int cnt = 0;
+			for (size_t i = 0; i < _Depot.size(); i++) {
+				cnt += _Depot[i]._Count;
+			}
+			return cnt;
+		};
+
+		private:
+
+		struct TCBatch {
+			char *_Head;
+			unsigned int _Count;
+		};
+
+		struct alignas(PSTD_CACHELINE_SIZE) TCMagazine {
+			TCBatch _Loaded;
+			TCBatch _Previous;
+
+			TCMagazine(void) {
+				_Loaded._Head = _Previous._Head = NULL;
+				_Loaded._Count = _Previous._Count = 0;
+			};
+		};
+
+
+		// move a batch from the depot into an empty magazine slot, growing the pool if allowed
+		bool Get_DepotBatch(TCBatch &dest) {
+			std::lock_guard<std::mutex> lock(_DepotLock);
+			if (_Depot.empty() && (!_GrowPool || !Add_Block())) {
+				return false;
+			}
+			dest = _Depot.back();
+			_Depot.pop_back();
+			return true;
+		};
+
+
+		// grow the pool by a block of _ObjPerBlock chunks and put them in the depot as batches (depot lock must be held)
+		bool Add_Block(void) {
+			if (!_ObjPerBlock) {
+				return false;
+			}
+			char *block = new (std::nothrow) char[(_ObjPerBlock + 1) * _ChunkSize];
+			if (!block) {
+				return false;
+			}
+			_BlockList.push_back(block);
+
+			// compute the point where we should start in the buffer so that memory is aligned
+			char *chunk = block;
+			while (((uintptr_t)chunk) & (std::alignment_of<T>::value - 1)) {
+				chunk++;
+			}
+
+			// link the chunks together in runs of _BatchSize
+			for (unsigned int i = 0; i < _ObjPerBlock; i += _BatchSize) {
+				unsigned int cnt = ((_ObjPerBlock - i) < _BatchSize) ? (_ObjPerBlock - i) : _BatchSize;
+				TCBatch batch;
+				batch._Head = &chunk[i * _ChunkSize];
+				batch._Count = cnt;
+				for (unsigned int j = 0; j < cnt - 1; j++) {
+					*(char **)(&chunk[(i + j) * _ChunkSize]) = &chunk[(i + j + 1) * _ChunkSize];
+				}
+				*(char **)(&chunk[(i + cnt - 1) * _ChunkSize]) = NULL;
+				_Depot.push_back(batch);
+			}
+			return true;
+		};
+
+
+		bool _GrowPool;							/*!< Flag indicating if memory pool should grow when it runs out of free chunks */
+		unsigned int _ObjPerBlock;				// Number of pooled objects per block
+		unsigned int _ChunkSize;				// Size of the properly aligned chunk of memory necessary to hold our object and pointer to the next available object
+		unsigned int _BatchSize;				// Number of chunks moved between a magazine and the depot at a time
+
+		TCMagazine *_Magazines;					// Per thread magazines indexed by thread slot
+		char *_MagazineMem;						// Backing memory for the magazines
+
+		std::mutex _DepotLock;					// Guards the depot and the block list
+		std::vector<TCBatch> _Depot;			// Batches of free chunks shared by all threads
+		std::vector<char *> _BlockList;			// The collection of memory blocks used to allocate objects
+	};
+
+}
+
+
+#endif
@@ -30,7 +30,7 @@ namespace PSTD {
 		}
 
 		bool Get_Resource(size_t id, T &val) {
-			if (id > _Resource.size()) return false;
+			if (id >= _Resource.size()) return false;
 			val = _Resource[id];
 			return true;
 		}
@@ -49,7 +49,7 @@ namespace PSTD {
 
 		std::vector<T> _Resource;
 		std::map<const std::string, int> _ResourceNameMap;
-	}
+	};
 
 };
 
@@ -1,3 +1,4 @@
+
 // sllist.h header for singly linked list class
 
 /*****************************************************************************
@@ -7,8 +8,13 @@
 #ifndef SLLISTPOOLED_H
 #define SLLISTPOOLED_H
 
+#include <stddef.h>
+#include <iterator>
+#include <utility>
 #include "PooledMemManager.hpp"
 
+#define SLL_THREAD_POOL_SIZE	1024			// nodes in each block of the per thread shared pool
+
 namespace PSTD {
 
 	// A singlely linked list implemented using pooled memory
@@ -17,28 +23,160 @@ namespace PSTD {
 	struct SLLNode {
 		T _Data;
 		SLLNode *_NextNode;
+
+		template <typename... Args>
+		explicit SLLNode(Args &&... args) : _Data(std::forward<Args>(args)...), _NextNode(NULL) {};
+	};
+
+
+	/** \brief Forward iterator over the nodes of a SLListPooled
+	 * \tparam T Type of the list's elements
+	 * \tparam V T for a mutable iterator, const T for a constant one
+	 */
+	template <typename T, typename V>
+	class SLLIterator {
+		public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef ptrdiff_t difference_type;
+		typedef V *pointer;
+		typedef V &reference;
+
+		SLLIterator(void) : _Node(NULL) {};
+		explicit SLLIterator(SLLNode<T> *node) : _Node(node) {};
+
+		// mutable iterators convert to constant ones
+		SLLIterator(const SLLIterator<T, T> &it) : _Node(it.Get_Node()) {};
+
+		V &operator*(void) const { return _Node->_Data; };
+		V *operator->(void) const { return &_Node->_Data; };
+
+		SLLIterator &operator++(void) {
+			_Node = _Node->_NextNode;
+			return *this;
+		};
+
+		SLLIterator operator++(int) {
+			SLLIterator prev = *this;
+			_Node = _Node->_NextNode;
+			return prev;
+		};
+
+		bool operator==(const SLLIterator &it) const { return _Node == it._Node; };
+		bool operator!=(const SLLIterator &it) const { return _Node != it._Node; };
+
+		SLLNode<T> *Get_Node(void) const { return _Node; };
+
+		private:
+		SLLNode<T> *_Node;
 	};
 
 
+	/** \brief Singly linked list with nodes allocated from a pool
+	 *
+	 * The list can be walked either with its internal cursor (Reset_List/Next_Node/Get_Data) or with STL style
+	 * forward iterators.  Modifications made through iterators keep the cursor valid when they happen right at
+	 * it and otherwise reset it to the head.
+	 * \tparam T Type of the elements, which may be move only
+	 */
 	template <typename T>
 	class SLListPooled {
 		public:
+		typedef PoolMemManager<SLLNode<T>> NodePool;
+		typedef SLLIterator<T, T> iterator;
+		typedef SLLIterator<T, const T> const_iterator;
+		typedef T value_type;
+
+		/** \brief Constructor for a list with a pool of its own
+		 * @param poolSize Number of nodes the list's pool holds
+		 */
 		SLListPooled(unsigned int poolSize) :
-			_MemManager(poolSize),
+			_Head(NULL),
+			_Rear(NULL),
+			_NextNode(NULL),
+			_PrevNode(NULL),
+			_CurNode(NULL),
 			_ListSize(0),
 			_CurListPos(-1),
+			_MemManager(new NodePool(poolSize)),
+			_Pool(_MemManager) { };
+
+		SLListPooled(T newdata, unsigned int poolSize) :
 			_Head(NULL),
 			_Rear(NULL),
 			_NextNode(NULL),
 			_PrevNode(NULL),
-			_CurNode(NULL) { };
-
-		SLListPooled(T newdata, unsigned int poolSize) : _MemManager(poolSize)	{ Insert_First(newData); };
+			_CurNode(NULL),
+			_ListSize(0),
+			_CurListPos(-1),
+			_MemManager(new NodePool(poolSize)),
+			_Pool(_MemManager) { Insert_First(std::move(newdata)); };
+
+		/** \brief Constructor for a list borrowing a pool owned elsewhere
+		 *
+		 * Any number of lists can share a pool, which must outlive them, and nodes move between such lists by
+		 * relinking.  The pool has the threading rules of PoolMemManager, so lists sharing one must be used from
+		 * one thread at a time.
+		 * @param pool Pool to allocate nodes from
+		 */
+		explicit SLListPooled(NodePool *pool) :
+			_Head(NULL),
+			_Rear(NULL),
+			_NextNode(NULL),
+			_PrevNode(NULL),
+			_CurNode(NULL),
+			_ListSize(0),
+			_CurListPos(-1),
+			_MemManager(NULL),
+			_Pool(pool) { };
+
+		/** \brief Constructor for a list using the calling thread's shared pool
+		 *
+		 * The list must be emptied or destroyed on the thread which created it, before that thread exits.
+		 */
+		SLListPooled(void) :
+			_Head(NULL),
+			_Rear(NULL),
+			_NextNode(NULL),
+			_PrevNode(NULL),
+			_CurNode(NULL),
+			_ListSize(0),
+			_CurListPos(-1),
+			_MemManager(NULL),
+			_Pool(Get_ThreadPool()) { };
 
 		~SLListPooled(void) {
-			for (unsigned int cnt = 0; cnt < _ListSize; cnt++) {
-				Delete_Head();
+			Clear();
+			delete _MemManager;
+		};
+
+
+		/** \brief Get the node pool shared by all lists of this type created on the calling thread
+		 * @return The thread's pool
+		 */
+		static NodePool *Get_ThreadPool(void) {
+			static thread_local NodePool pool(SLL_THREAD_POOL_SIZE, true);
+			return &pool;
+		};
+
+
+		/** \brief Get the pool the list allocates its nodes from
+		 * @return Node pool
+		 */
+		NodePool *Get_Pool(void) { return _Pool; };
+
+
+		/** \brief Remove every element from the list */
+		void Clear(void) {
+			SLLNode<T> *node = _Head;
+			while (node) {
+				SLLNode<T> *next = node->_NextNode;
+				Free_Node(node);
+				node = next;
 			}
+			_Head = _Rear = NULL;
+			_ListSize = 0;
+			Reset_List();
 		};
 
 		void Reset_List(void) {
@@ -58,57 +196,13 @@ namespace PSTD {
 
 
 		void Insert_Head(T newdata) {
-
-			// check the case that this is the first element being inserted
-			if (_ListSize == 0) {
-				Insert_First(newdata);
-			}
-
-			// otherwise we handle it normally 
-			else {
-
-				SLLNode<T> *tempnode = _MemManager.Allocate_Object();
-
-				tempnode->_Data = newdata;
-				tempnode->_NextNode = _Head;
-				_Head = tempnode;
-				_ListSize++;
-
-				// handle the case where curnode = head
-				if (_CurListPos == 0) {
-					_PrevNode = _Head;
-					_NextNode = _CurNode->_NextNode;
-				}
-
-				// and increment CurListPos as a node it is one position to the right of
-				//   where is used to be
-				_CurListPos++;
-			}
+			SLLNode<T> *tempnode = Allocate_Node(std::move(newdata));
+			Link_Chain(NULL, tempnode, tempnode, 1);
 		};
 
 		void Insert_Rear(T newdata) {
-
-			// handle 1st element case
-			if (_ListSize == 0) {
-				Insert_First(newdata);
-			}
-			else {
-
-				// handle allocation appropriately
-
-				SLLNode<T> *tempnode = _MemManager.Allocate_Object();
-
-				tempnode->_Data = newdata;
-				tempnode->_NextNode = NULL;
-				_Rear->_NextNode = tempnode;
-				_Rear = tempnode;
-				_ListSize++;
-
-				// handle the case that CurNode was at the rear when we entered method
-				if (_CurListPos == (_ListSize - 2)) {
-					_NextNode = _Rear;
-				}
-			}
+			SLLNode<T> *tempnode = Allocate_Node(std::move(newdata));
+			Link_Chain(_Rear, tempnode, tempnode, 1);
 		};
 
 
@@ -116,13 +210,12 @@ namespace PSTD {
 
 			// handle 1st element case
 			if (_ListSize == 0) {
-				Insert_First(newdata);
+				Insert_First(std::move(newdata));
 			}
 
 			else {
-				SLLNode<T> *tempnode = _MemManager.Allocate_Object();
+				SLLNode<T> *tempnode = Allocate_Node(std::move(newdata));
 
-				tempnode->_Data = newdata;
 				tempnode->_NextNode = _NextNode;
 				_CurNode->_NextNode = tempnode;
 				_NextNode = tempnode;
@@ -140,23 +233,22 @@ namespace PSTD {
 
 			// handle 1st element case
 			if (_ListSize == 0) {
-				Insert_First(newdata);
+				Insert_First(std::move(newdata));
 			}
 
 			// handle the case the current node is at the head
-			else if (!PrevNode) {
-				Insert_Head(newdata);
-				_CurListPos = 1;
+			else if (!_PrevNode) {
+				Insert_Head(std::move(newdata));
 			}
 
 			// handle all other cases
 			else {
 
-				SLLNode<T> *tempnode = _MemManager->Allocate_Object();
+				SLLNode<T> *tempnode = Allocate_Node(std::move(newdata));
 
-				tempnode->_Data = newdata;
 				tempnode->_NextNode = _CurNode;
 				_PrevNode->_NextNode = tempnode;
+				_PrevNode = tempnode;
 				_CurListPos++;
 				_ListSize++;
 			}
@@ -175,7 +267,7 @@ namespace PSTD {
 			if (_ListSize != 1) {
 				SLLNode<T> *tempnode = _Head->_NextNode;
 
-				_MemManager.Free_Object(_Head);
+				Free_Node(_Head);
 
 				_Head = tempnode;
 				_ListSize--;
@@ -184,12 +276,15 @@ namespace PSTD {
 				}
 				else {
 					_CurListPos--;
+					if (_CurListPos == 0) {
+						_PrevNode = NULL;
+					}
 				}
 			}
 
 			// handle the case of one element
 			else {
-				_MemManager.Free_Object(_Head);
+				Free_Node(_Head);
 				_ListSize--;
 				_CurListPos = -1;
 				_Head = _Rear = _NextNode = _PrevNode = _CurNode = NULL;
@@ -197,42 +292,46 @@ namespace PSTD {
 		};
 
 
+		/** \brief Delete the last element of the list
+		 *
+		 * The node before the rear is found from the cursor when it sits at or just before the rear, otherwise it
+		 * takes a single walk of the list.  If the cursor was on the rear it moves back one element.
+		 */
 		void Delete_Rear(void)  {
-			void *tempdata;
-			int curpos, cnt;
 
-			if (_ListSize == 0) {
-				return NULL;
+			if (_ListSize <= 1) {
+				Delete_Head();
+				return;
 			}
 
+			SLLNode<T> *prev;
 
-			// save the state of the current node
-			curpos = _CurListPos;
+			// the cursor is on the rear, so it has to step back and we need the node before its previous one too
 			if (_CurNode == _Rear) {
-				curpos--;
+				SLLNode<T> *prevPrev = NULL;
+				for (prev = _Head; prev != _PrevNode; prev = prev->_NextNode) {
+					prevPrev = prev;
+				}
+				_CurNode = _PrevNode;
+				_PrevNode = prevPrev;
+				_NextNode = NULL;
+				_CurListPos--;
 			}
 
-			Reset_List();
-
-			// go to the last position in the list
-			while (Next_Node());
-
-			// do this stuff if there is more then one element in the list
-			if (_PrevNode != NULL) {
-				_PrevNode->NextNode = NULL;
-				_MemManager->Free_Object(_Rear);
-
-				_Rear = _PrevNode;
+			// the cursor is just before the rear
+			else if (_NextNode == _Rear) {
+				prev = _CurNode;
+				_NextNode = NULL;
 			}
-			_ListSize--;
 
-			// now go back to the current position
-			Reset_List();
-			for (cnt = 0; cnt < curpos; cnt++) {
-				Next_Node();
+			else {
+				for (prev = _Head; prev->_NextNode != _Rear; prev = prev->_NextNode);
 			}
 
-			return tempdata;
+			prev->_NextNode = NULL;
+			Free_Node(_Rear);
+			_Rear = prev;
+			_ListSize--;
 		};
 
 
@@ -240,46 +339,40 @@ namespace PSTD {
 
 			// handle case where there is an empty list
 			if (_ListSize == 0) {
-				return NULL;
+				return;
 			}
 
 			// handle deletion from front of list
 			if (_CurListPos == 0) {
-				return Delete_Head();
+				Delete_Head();
+				return;
 			}
 
 			// handle deletion from rear of list
-			if (_CurListPos == _ListSize - 1) {
-				return Delete_Rear();
+			if (_CurNode == _Rear) {
+				Delete_Rear();
+				return;
 			}
 
-			_PrevNode->_NextNode = _CurNode - _ > NextNode;
+			_PrevNode->_NextNode = _NextNode;
 
-			_MemManager->Free_Object(_CurNode);
+			Free_Node(_CurNode);
 
 			_ListSize--;
 			_CurNode = _NextNode;
-			_NextNode = NextNode->_NextNode;
+			_NextNode = _CurNode->_NextNode;
 		};
 
 
 		bool Has_Data(void) { return _ListSize != 0; };
 
 
-		T Get_Data(void) {
-			if (_ListSize == 0) {
-				return NULL;
-			}
-			return _CurNode->_Data;
-		};
+		/** \brief Get the element at the cursor, the list must not be empty */
+		T &Get_Data(void) { return _CurNode->_Data; };
 
 
-		T Get_Head(void)  {
-			if (_ListSize == 0) {
-				return NULL;
-			}
-			return _Head->_Data;
-		};
+		/** \brief Get the first element, the list must not be empty */
+		T &Get_Head(void) { return _Head->_Data; };
 
 
 		bool Next_Node(void) {
@@ -299,7 +392,7 @@ namespace PSTD {
 		bool Goto_Node(int seekpos)  {
 
 			// check for valid positions
-			if ((seekpos < 0) || (seekpos > _ListSize - 1)) {
+			if ((seekpos < 0) || (seekpos >= (int)_ListSize)) {
 				return false;
 			}
 
@@ -316,46 +409,324 @@ namespace PSTD {
 		};
 
 
+		/** \brief Insert a copy of another list in front of this one, keeping its order
+		 * @param templist List to copy
+		 */
 		void Insert_ListHead(SLListPooled<T> *templist) {
-			;
-			unsigned int listsize = templist->Get_ListSize();
-			templist->Reset_List();
-
-			for (unsigned int cnt = 0; cnt < listsize; cnt++) {
-				Insert_Head(mlist->Get_Data());
-				templist->Next_Node();
-			}
+			SLLNode<T> *first, *last;
+			Copy_Chain(templist, first, last);
+			Link_Chain(NULL, first, last, templist->Get_ListSize());
 		};
 
 
+		/** \brief Append a copy of another list to this one
+		 * @param templist List to copy
+		 */
 		void Insert_ListRear(SLListPooled<T> *templist)  {
+			SLLNode<T> *first, *last;
+			Copy_Chain(templist, first, last);
+			Link_Chain(_Rear, first, last, templist->Get_ListSize());
+		};
 
-			unsigned listsize = templist->Get_ListSize();
-			templist->Reset_List();
 
-			for (unsigned int cnt = 0; cnt < listsize; cnt++) {
-				Insert_Rear(mlist->Get_Data());
-				templist->Next_Node();
+		/** \brief Move all elements of another list in front of this one, leaving the other list empty
+		 *
+		 * Constant time when both lists allocate from the same pool, otherwise the elements are moved node by node.
+		 * @param other List to take the elements from
+		 */
+		void Splice_Head(SLListPooled<T> &other) {
+			if (&other == this) {
+				return;
 			}
+			unsigned int cnt = other._ListSize;
+			SLLNode<T> *first, *last;
+			Take_Chain(other, first, last);
+			Link_Chain(NULL, first, last, cnt);
+		};
+
 
+		/** \brief Move all elements of another list onto the rear of this one, leaving the other list empty
+		 *
+		 * Constant time when both lists allocate from the same pool, otherwise the elements are moved node by node.
+		 * @param other List to take the elements from
+		 */
+		void Splice_Rear(SLListPooled<T> &other) {
+			if (&other == this) {
+				return;
+			}
+			unsigned int cnt = other._ListSize;
+			SLLNode<T> *first, *last;
+			Take_Chain(other, first, last);
+			Link_Chain(_Rear, first, last, cnt);
 		};
 
 
 		int Get_CurrentPos(void) { return _CurListPos; };
 
+
+		iterator begin(void) { return iterator(_Head); };
+		iterator end(void) { return iterator(); };
+		const_iterator begin(void) const { return const_iterator(_Head); };
+		const_iterator end(void) const { return const_iterator(); };
+		const_iterator cbegin(void) const { return const_iterator(_Head); };
+		const_iterator cend(void) const { return const_iterator(); };
+
+
+		/** \brief Construct an element in place after a position
+		 * @param pos Position to insert after, must refer to an element
+		 * @param args Arguments forwarded to the element's constructor
+		 * @return Iterator to the new element
+		 */
+		template <typename... Args>
+		iterator emplace_after(const_iterator pos, Args &&... args) {
+			SLLNode<T> *tempnode = Allocate_Node(std::forward<Args>(args)...);
+			Link_Chain(pos.Get_Node(), tempnode, tempnode, 1);
+			return iterator(tempnode);
+		};
+
+
+		/** \brief Insert an element after a position
+		 * @param pos Position to insert after, must refer to an element
+		 * @param newdata Element to insert
+		 * @return Iterator to the new element
+		 */
+		iterator insert_after(const_iterator pos, T newdata) { return emplace_after(pos, std::move(newdata)); };
+
+
+		/** \brief Remove the element following a position
+		 * @param pos Position before the element to remove, must refer to an element
+		 * @return Iterator to the element which followed the removed one
+		 */
+		iterator erase_after(const_iterator pos) {
+			SLLNode<T> *prev = pos.Get_Node();
+			SLLNode<T> *tempnode = prev->_NextNode;
+
+			if (!tempnode) {
+				return end();
+			}
+
+			prev->_NextNode = tempnode->_NextNode;
+			if (tempnode == _Rear) {
+				_Rear = prev;
+			}
+			Free_Node(tempnode);
+			_ListSize--;
+
+			if (prev == _CurNode) {
+				_NextNode = prev->_NextNode;
+			}
+			else {
+				Reset_List();
+			}
+			return iterator(prev->_NextNode);
+		};
+
+
+		/** \brief Move all elements of another list in after a position, leaving the other list empty
+		 *
+		 * Constant time when both lists allocate from the same pool, otherwise the elements are moved node by node.
+		 * @param pos Position to insert after, must refer to an element
+		 * @param other List to take the elements from
+		 */
+		void splice_after(const_iterator pos, SLListPooled<T> &other) {
+			if (&other == this) {
+				return;
+			}
+			unsigned int cnt = other._ListSize;
+			SLLNode<T> *first, *last;
+			Take_Chain(other, first, last);
+			Link_Chain(pos.Get_Node(), first, last, cnt);
+		};
+
+
+
+		/** \brief Move a single element of another list in after a position
+		 *
+		 * The node is relinked when both lists share a pool, otherwise its element is moved into a new node.
+		 * @param pos Position to insert after, must refer to an element
+		 * @param other List to take the element from, which may be this list
+		 * @param before Position in other before the element to move, must refer to an element
+		 */
+		void splice_after(const_iterator pos, SLListPooled<T> &other, const_iterator before) {
+			SLLNode<T> *tempnode = before.Get_Node()->_NextNode;
+			if (!tempnode || (tempnode == pos.Get_Node()) || (before == pos)) {
+				return;
+			}
+
+			other.Unlink_After(before.Get_Node());
+			if (_Pool != other._Pool) {
+				SLLNode<T> *moved = Allocate_Node(std::move(tempnode->_Data));
+				other.Free_Node(tempnode);
+				tempnode = moved;
+			}
+			Link_Chain(pos.Get_Node(), tempnode, tempnode, 1);
+		};
+
+
+		/** \brief Move the first element of another list onto the rear of this one
+		 *
+		 * The node is relinked when both lists share a pool, otherwise its element is moved into a new node.
+		 * @param other List to take the element from
+		 */
+		void Take_Head(SLListPooled<T> &other) {
+			if ((&other == this) || (other._ListSize == 0)) {
+				return;
+			}
+
+			SLLNode<T> *tempnode = other._Head;
+			other.Unlink_After(NULL);
+			if (_Pool != other._Pool) {
+				SLLNode<T> *moved = Allocate_Node(std::move(tempnode->_Data));
+				other.Free_Node(tempnode);
+				tempnode = moved;
+			}
+			Link_Chain(_Rear, tempnode, tempnode, 1);
+		};
+
 		protected:
-		void Insert_First(T newdata)  {
+		SLListPooled(const SLListPooled<T> &);
+		SLListPooled<T> &operator=(const SLListPooled<T> &);
+
+		template <typename... Args>
+		void Insert_First(Args &&... args)  {
 
-			_CurNode = _MemManager.Allocate_Object();
+			_CurNode = Allocate_Node(std::forward<Args>(args)...);
 
-			_CurNode->_Data = newdata;
-			_CurNode->_NextNode = NULL;
 			_Head = _Rear = _CurNode;
 			_PrevNode = _NextNode = NULL;
 			_CurListPos = 0;
 			_ListSize = 1;
 		};
 
+
+		template <typename... Args>
+		SLLNode<T> *Allocate_Node(Args &&... args) {
+			return _Pool->Allocate_Object(std::forward<Args>(args)...);
+		};
+
+		void Free_Node(SLLNode<T> *node) {
+			node->~SLLNode<T>();
+			_Pool->Free_Object(node);
+		};
+
+
+		// link a chain of cnt nodes in after prev, or at the head if prev is NULL, keeping the cursor in place
+		void Link_Chain(SLLNode<T> *prev, SLLNode<T> *first, SLLNode<T> *last, unsigned int cnt) {
+			if (!first) {
+				return;
+			}
+
+			if (_ListSize == 0) {
+				last->_NextNode = NULL;
+				_Head = first;
+				_Rear = last;
+				_ListSize = cnt;
+				Reset_List();
+				return;
+			}
+
+			if (prev == NULL) {
+				last->_NextNode = _Head;
+				_Head = first;
+				if (_CurListPos == 0) {
+					_PrevNode = last;
+				}
+				_CurListPos += cnt;
+			}
+			else {
+				bool atRear = (prev == _Rear);
+
+				last->_NextNode = prev->_NextNode;
+				prev->_NextNode = first;
+				if (atRear) {
+					_Rear = last;
+				}
+
+				// the cursor only moves if the chain went in before it
+				if (prev == _CurNode) {
+					_NextNode = first;
+				}
+				else if (prev == _PrevNode) {
+					_PrevNode = last;
+					_CurListPos += cnt;
+				}
+				else if (!atRear) {
+					Reset_List();
+				}
+			}
+			_ListSize += cnt;
+		};
+
+
+		// take the node after prev, or the head if prev is NULL, out of the list without freeing it
+		void Unlink_After(SLLNode<T> *prev) {
+			SLLNode<T> *tempnode = (prev) ? prev->_NextNode : _Head;
+
+			if (prev) {
+				prev->_NextNode = tempnode->_NextNode;
+			}
+			else {
+				_Head = tempnode->_NextNode;
+			}
+			if (tempnode == _Rear) {
+				_Rear = prev;
+			}
+			tempnode->_NextNode = NULL;
+			_ListSize--;
+
+			if ((prev == _CurNode) && prev) {
+				_NextNode = prev->_NextNode;
+			}
+			else {
+				Reset_List();
+			}
+		};
+
+
+		// build a chain of copies of another list's elements
+		void Copy_Chain(SLListPooled<T> *templist, SLLNode<T> *&first, SLLNode<T> *&last) {
+			first = last = NULL;
+			for (SLLNode<T> *node = templist->_Head; node; node = node->_NextNode) {
+				SLLNode<T> *tempnode = Allocate_Node(node->_Data);
+				if (last) {
+					last->_NextNode = tempnode;
+				}
+				else {
+					first = tempnode;
+				}
+				last = tempnode;
+			}
+		};
+
+
+		// take the nodes of another list, relinking them if it shares our pool and moving their data otherwise
+		void Take_Chain(SLListPooled<T> &other, SLLNode<T> *&first, SLLNode<T> *&last) {
+			if (_Pool == other._Pool) {
+				first = other._Head;
+				last = other._Rear;
+			}
+			else {
+				first = last = NULL;
+				SLLNode<T> *node = other._Head;
+				while (node) {
+					SLLNode<T> *next = node->_NextNode;
+					SLLNode<T> *tempnode = Allocate_Node(std::move(node->_Data));
+					if (last) {
+						last->_NextNode = tempnode;
+					}
+					else {
+						first = tempnode;
+					}
+					last = tempnode;
+					other.Free_Node(node);
+					node = next;
+				}
+			}
+			other._Head = other._Rear = NULL;
+			other._ListSize = 0;
+			other.Reset_List();
+		};
+
 		// +ECM+
 
 		SLLNode<T> *_Head;
@@ -365,7 +736,8 @@ namespace PSTD {
 		SLLNode<T> *_CurNode;
 		unsigned int _ListSize;
 		int _CurListPos;
-		PoolMemManager<SLLNode<T>> _MemManager;
+		NodePool *_MemManager;					// Pool owned by the list, NULL when it borrows one
+		NodePool *_Pool;						// Pool nodes are allocated from
 
 	};
 
@@ -374,4 +746,3 @@ namespace PSTD {
 
 
 #endif
-
@@ -5,6 +5,12 @@
 
 #include <vector>
 #include <list>
+#include <iterator>
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "PStringtable.h"
 
 
 
@@ -12,28 +18,108 @@
 //   and potential performance increases when trying to find a key with a string table reference
 
 #define HT_ALLOC_SIZE	256
+#define STKHT_MAX_LOAD		1			// keys per bucket which starts the table growing
+#define STKHT_REHASH_STEP	4			// buckets moved to the grown table per insert
+#define STKHT_PTR_MULT		0x9E3779B97F4A7C15ULL	// Fibonacci hashing multiplier for key pointers
 
 namespace PSTD {
 
 	template<typename T>
 	struct STKHTNode {
 		const char *_Key;
+		unsigned int _Hash;
 		T _Val;
 		STKHTNode *_Next;
 
-		STKHTNode() : _Key(NULL), _Next(NULL) {};
+		STKHTNode() : _Key(NULL), _Hash(0), _Next(NULL) {};
 	};
 
+	template<typename T, int N>
+	class STKeyedHashTable;
+
+
+	// forward iterator over the nodes of a STKeyedHashTable in memory order, every node lives in an overflow block
+	//   so a walk is a linear scan of the blocks.  V is T or const T
+	template<typename T, int N, typename V>
+	class STKHTIterator {
+		public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef STKHTNode<T> value_type;
+		typedef ptrdiff_t difference_type;
+		typedef typename std::conditional<std::is_const<V>::value, const STKHTNode<T>, STKHTNode<T>>::type Node;
+		typedef Node *pointer;
+		typedef Node &reference;
+
+		STKHTIterator(void) : _HT(NULL), _Block(0), _Node(NULL), _End(NULL) {};
+		explicit STKHTIterator(const STKeyedHashTable<T, N> *ht) : _HT(ht), _Block(0), _Node(NULL), _End(NULL) {
+			if (!_HT->Get_Block(0, _Node, _End)) _Node = NULL;
+		};
+
+		// mutable iterators convert to constant ones
+		STKHTIterator(const STKHTIterator<T, N, T> &it) : _HT(it._HT), _Block(it._Block), _Node(it._Node), _End(it._End) {};
+
+		Node &operator*(void) const { return *_Node; };
+		Node *operator->(void) const { return _Node; };
+
+		const char *Get_Key(void) const { return _Node->_Key; };
+		V &Get_Val(void) const { return _Node->_Val; };
+
+		STKHTIterator &operator++(void) {
+			if ((++_Node == _End) && !_HT->Get_Block(++_Block, _Node, _End)) {
+				_Node = NULL;
+			}
+			return *this;
+		};
+
+		STKHTIterator operator++(int) {
+			STKHTIterator prev = *this;
+			++*this;
+			return prev;
+		};
+
+		bool operator==(const STKHTIterator &it) const { return _Node == it._Node; };
+		bool operator!=(const STKHTIterator &it) const { return _Node != it._Node; };
+
+		private:
+		template<typename, int, typename> friend class STKHTIterator;
+
+		const STKeyedHashTable<T, N> *_HT;
+		unsigned int _Block;
+		STKHTNode<T> *_Node;
+		STKHTNode<T> *_End;
+	};
+
+	// Keys set through Set_ST are also remembered in a direct mapped cache indexed by the key's address, so Get_ST
+	//   and repeated Set_ST calls usually find a string table key without hashing its characters.  Only Set_ST
+	//   writes the cache, so Get_ST and Get may be called from many threads once the table is built.
+	//
+	// The table doubles its bucket count once it holds more than STKHT_MAX_LOAD keys per bucket.  Growth is
+	//   incremental, the old buckets are moved over a few at a time by the following inserts and lookups search
+	//   both tables until the move is done.
 	template<typename T, int N = 128>
 	class STKeyedHashTable {
 		public:
-		STKeyedHashTable(unsigned int allocSize = HT_ALLOC_SIZE) : _TableSize(N), _NumKeys(0), _OverflowCnt(0), _OverflowPos(allocSize), _OverflowAllocSize(allocSize) {
-			_Table = new STKHTNode<T>[_TableSize];
-
+		typedef STKHTIterator<T, N, T> iterator;
+		typedef STKHTIterator<T, N, const T> const_iterator;
+
+		STKeyedHashTable(unsigned int allocSize = HT_ALLOC_SIZE) :
+			_OldTable(NULL),
+			_TableSize(N),
+			_OldTableSize(0),
+			_RehashPos(0),
+			_OverflowAllocSize(allocSize),
+			_NumKeys(0),
+			_OverflowCnt(0),
+			_OverflowPos(allocSize)
+		{
+			_Table = new STKHTNode<T> *[_TableSize]();
+			Init_PtrCache();
 		}
 
 		~STKeyedHashTable(void) {
 			delete[] _Table;
+			delete[] _PtrCache;
+			delete[] _OldTable;
 			for (size_t i = 0; i < _Overflow.size(); i++) {
 				delete[] _Overflow[i];
 			}
@@ -42,116 +128,189 @@ namespace PSTD {
 		// set the entry for key to val potentially replacing preexisting values
 		//   this is the case where we know key is a pointer to a string table string
 		void Set_ST(const char *key, T val, bool replace = true) {
-			unsigned int hash = 2166136261;
-			for (const char *s = key; *s; s++) hash = (16777619 * hash) ^ (*s);
-			hash &= (_TableSize - 1);
-
-			if (!_Table[hash]._Key) {
-				_Table[hash]._Key = key;
-				_Table[hash]._Val = val;
-				return;
-			}
-
-			STKHTNode<T> *node = &_Table[hash];
-
-			// check for a matching key, if none exists add it to the string and hash table
-			do {
-
-				// replace existing key if it already exists  (if we are using keys that originate from the string table, we can just compare ptrs)
-				if (node->_Key == key) {
-					if (replace) _Table[hash]._Val = val;
-					return;
-				}
-				if (node->_Next) {
-					node = node->_Next;
-				}
-			} while (node->_Next);
+			Set_Ptr(key, 0, false, val, replace);
+		}
 
-			Place_InOverflow(key, val);
+		// as above, an interned string brings its hash along so the key's characters are never read
+		void Set_ST(PInternedString key, T val, bool replace = true) {
+			Set_Ptr(key.Get_String(), (unsigned int)key.Get_Hash(), true, val, replace);
 		}
 
 
 		// set the entry for key to val potentially replacing preexisting values
 		//   this is the case where we don't know if key is a pointer to a string table string
 		void Set(const char *key, T val) {
+			unsigned int hash = Hash_Key(key);
 
-			unsigned int hash = 2166136261;
-			for (const char *s = key; *s; s++) hash = (16777619 * hash) ^ (*s);
-			hash &= (_TableSize - 1);
+			if (_OldTable) {
+				Rehash_Step();
+			}
 
-			if (!_Table[hash]._Key) {
-				_Table[hash]._Key = key;
-				_Table[hash]._Val = val;
+			STKHTNode<T> *node = Find_Node(key, hash, false);
+			if (node) {
+				node->_Val = val;
 				return;
 			}
 
-			STKHTNode<T> *node = &_Table[hash];
+			Place_InOverflow(key, hash, val);
+		}
 
-			// check for a matching key, if none exists add it to the string and hash table
-			do {
 
-				// replace existing key if it already exists  (if we are using keys that originate from the string table, we can just compare ptrs)
-				if (!strcmp(node->_Key, key)) {
-					_Table[hash]._Val = val;
-					return;
-				}
-				if (node->_Next) {
-					node = node->_Next;
-				}
-			} while (node->_Next);
+		// get the entry for key, which must be a pointer to a string table string
+		//   keys are compared by address only and a cached key doesn't have to be hashed, a miss doesn't fill the
+		//   cache so concurrent calls are safe while nothing is being set
+		bool Get_ST(const char *key, T &val) const {
+			return Get_Ptr(key, 0, false, val);
+		}
 
-			Place_InOverflow(key, val);
+		bool Get_ST(PInternedString key, T &val) const {
+			return Get_Ptr(key.Get_String(), (unsigned int)key.Get_Hash(), true, val);
 		}
 
 
 		bool Get(const char *key, T &val) const {
-			unsigned int hash = 2166136261;
-			for (const char *s = key; *s; s++) hash = (16777619 * hash) ^ (*s);
-			hash &= (_TableSize - 1);
+			STKHTNode<T> *node = Find_Node(key, Hash_Key(key), false);
+			if (!node) return false;
+
+			val = node->_Val;
+			return true;
+		}
 
-			// check in main bucket
-			if (!_Table[hash]._Key) return false;
 
-			STKHTNode<T> *node = &_Table[hash];
+		iterator begin(void) { return iterator(this); };
+		iterator end(void) { return iterator(); };
+		const_iterator begin(void) const { return const_iterator(this); };
+		const_iterator end(void) const { return const_iterator(); };
+		const_iterator cbegin(void) const { return const_iterator(this); };
+		const_iterator cend(void) const { return const_iterator(); };
 
-			// check in chained bucket
-			do {
 
-				// found in chain bucket
-				if (!strcmp(node->_Key, key)) {
-					val = node->_Val;
-					return true;
+		// call func(key, val) for every key, in insertion order
+		template<typename Func>
+		void For_Each(Func func) {
+			STKHTNode<T> *node, *end;
+			for (unsigned int i = 0; Get_Block(i, node, end); i++) {
+				for (; node < end; node++) {
+					func(node->_Key, node->_Val);
 				}
-			} while (node = node->_Next);
+			}
+		}
 
-			return false;
+
+		// copy up to maxCnt keys and values into caller provided arrays, either may be NULL
+		//   returns the number of items copied
+		unsigned int Export_Items(const char **keys, T *vals, unsigned int maxCnt) const {
+			unsigned int cnt = 0;
+			STKHTNode<T> *node, *end;
+			for (unsigned int i = 0; (cnt < maxCnt) && Get_Block(i, node, end); i++) {
+				if ((unsigned int)(end - node) > maxCnt - cnt) {
+					end = node + (maxCnt - cnt);
+				}
+				if (keys) {
+					for (STKHTNode<T> *n = node; n < end; n++) keys[cnt + (n - node)] = n->_Key;
+				}
+				if (vals) {
+					for (STKHTNode<T> *n = node; n < end; n++) vals[cnt + (n - node)] = n->_Val;
+				}
+				cnt += (unsigned int)(end - node);
+			}
+			return cnt;
 		}
 
 
+		// allocates a list node per item, prefer the iterators or Export_Items
 		std::list<T> *Get_ItemList(void) {
 			std::list<T> *items = new std::list<T>();
+			for (iterator it = begin(); it != end(); ++it) {
+				items->push_back(it->_Val);
+			}
+			return items;
+		}
+		unsigned int Get_NumKeys(void) const { return _NumKeys; };
+		unsigned int Get_TableSize(void) const { return _TableSize; };
 
-			for (unsigned int i = 0; i < _TableSize; i++) {
-				if (_Table[i]._Key) {
-					items->push_back(_Table[i]._Val);
-				}
+
+		private:
+		friend class STKHTIterator<T, N, T>;
+		friend class STKHTIterator<T, N, const T>;
+
+		// the low bits of the hash a string table stores with each string, so interned keys never need hashing
+		static unsigned int Hash_Key(const char *key) {
+			return (unsigned int)PInternedString::Hash_String(key, strlen(key));
+		}
+
+
+		// Set_ST and Get_ST, hash is only computed from the key on a pointer cache miss unless it is given
+		void Set_Ptr(const char *key, unsigned int hash, bool hashed, T val, bool replace) {
+			if (_OldTable) {
+				Rehash_Step();
 			}
-			for (int i = 0; i < _OverflowCnt - 1; i++) {
-				for (unsigned int j = 0; j < _OverflowAllocSize; j++) {
-					items->push_back(_Overflow[i][j]);
-				}
+
+			STKHTNode<T> **cached = Get_PtrCacheSlot(key);
+
+			// if we are using keys that originate from the string table, we can just compare ptrs
+			STKHTNode<T> *node = (*cached && ((*cached)->_Key == key)) ? *cached : NULL;
+			if (!node) {
+				if (!hashed) hash = Hash_Key(key);
+				node = Find_Node(key, hash, true);
 			}
-			for (unsigned int i = 0; i < _OverflowPos; i++) {
-				items->push_back(_Overflow[_OverflowCnt][j]);
+			if (node) {
+				if (replace) node->_Val = val;
+				*cached = node;
+				return;
 			}
-			return items;
+
+			// placing the node may grow the table and with it the cache
+			node = Place_InOverflow(key, hash, val);
+			*Get_PtrCacheSlot(key) = node;
 		}
-		unsigned int Get_NumKeys(void) { return _NumKeys; };
 
+		bool Get_Ptr(const char *key, unsigned int hash, bool hashed, T &val) const {
+			STKHTNode<T> **cached = Get_PtrCacheSlot(key);
+			STKHTNode<T> *node = *cached;
 
-		private:
+			if (!node || (node->_Key != key)) {
+				node = Find_Node(key, hashed ? hash : Hash_Key(key), true);
+				if (!node) return false;
+			}
+
+			val = node->_Val;
+			return true;
+		}
 
-		void Place_InOverflow(const char *key, T val) {
+
+		// node range of overflow block i, all of them full but the last
+		//   returns false past the last block
+		bool Get_Block(unsigned int i, STKHTNode<T> *&begin, STKHTNode<T> *&end) const {
+			if (i >= _OverflowCnt) return false;
+
+			begin = _Overflow[i];
+			end = begin + ((i == _OverflowCnt - 1) ? _OverflowPos : _OverflowAllocSize);
+			return true;
+		}
+
+
+		// look for key in its bucket of the table, and of the old table if that bucket hasn't been moved yet
+		STKHTNode<T> *Find_Node(const char *key, unsigned int hash, bool byPtr) const {
+			STKHTNode<T> *node = _Table[hash & (_TableSize - 1)];
+
+			for (int pass = 0; pass < 2; pass++) {
+				for (; node; node = node->_Next) {
+					if ((node->_Key == key) || (!byPtr && (node->_Hash == hash) && !strcmp(node->_Key, key))) {
+						return node;
+					}
+				}
+
+				if (!_OldTable || ((hash & (_OldTableSize - 1)) < _RehashPos)) {
+					break;
+				}
+				node = _OldTable[hash & (_OldTableSize - 1)];
+			}
+			return NULL;
+		}
+
+
+		STKHTNode<T> *Place_InOverflow(const char *key, unsigned int hash, T val) {
 
 			// out of overflow block size so make new one
 			if (_OverflowPos == _OverflowAllocSize) {
@@ -162,17 +321,104 @@ namespace PSTD {
 			}
 
 
-			// add the string to the next available bucket
-			_Overflow.back()[_OverflowPos]._Key = key;
-			_Overflow.back()[_OverflowPos]._Val = val;
-			node->_Next = &_Overflow.back()[_OverflowPos++];
+			// add the string to the next available node and put it at the front of its bucket
+			STKHTNode<T> *node = &_Overflow.back()[_OverflowPos++];
+			unsigned int bucket = hash & (_TableSize - 1);
+			node->_Key = key;
+			node->_Hash = hash;
+			node->_Val = val;
+			node->_Next = _Table[bucket];
+			_Table[bucket] = node;
 			_NumKeys++;
+
+			if (!_OldTable && (_NumKeys > _TableSize * STKHT_MAX_LOAD)) {
+				Start_Rehash();
+			}
+			return node;
+		}
+
+
+		// swap in a table with twice the buckets, the old one is emptied by Rehash_Step
+		void Start_Rehash(void) {
+			_OldTable = _Table;
+			_OldTableSize = _TableSize;
+			_RehashPos = 0;
+			_TableSize *= 2;
+			_Table = new STKHTNode<T> *[_TableSize]();
+
+			// the pointer cache grows with the table and starts empty, Set_ST refills it and a miss falls back
+			//   to searching the buckets, so growth stays free of any pass over every key
+			delete[] _PtrCache;
+			Init_PtrCache();
+		}
+
+
+		// the pointer cache has two slots per bucket, nodes never move so a slot can't go stale
+		void Init_PtrCache(void) {
+			_PtrCache = new STKHTNode<T> *[_TableSize * 2]();
+			_PtrCacheShift = 64;
+			for (unsigned int size = _TableSize * 2; size > 1; size >>= 1) {
+				_PtrCacheShift--;
+			}
+		}
+
+		STKHTNode<T> **Get_PtrCacheSlot(const char *key) const {
+			return &_PtrCache[(size_t)(((uint64_t)(uintptr_t)key * STKHT_PTR_MULT) >> _PtrCacheShift)];
+		}
+
+
+		// move up to STKHT_REHASH_STEP non empty buckets, bounding the number of empty ones skipped
+		void Rehash_Step(void) {
+			unsigned int moved = 0;
+			unsigned int visits = STKHT_REHASH_STEP * 10;
+
+			while ((moved < STKHT_REHASH_STEP) && (_RehashPos < _OldTableSize) && visits--) {
+				STKHTNode<T> *node = _OldTable[_RehashPos];
+				if (node) {
+					moved++;
+				}
+				while (node) {
+					STKHTNode<T> *next = node->_Next;
+					unsigned int bucket = node->_Hash & (_TableSize - 1);
+					node->_Next = _Table[bucket];
+					_Table[bucket] = node;
+					node = next;
+				}
+				_OldTable[_RehashPos++] = NULL;
+			}
+
+			if (_RehashPos == _OldTableSize) {
+				delete[] _OldTable;
+				_OldTable = NULL;
+			}
 		}
 
 
 
 
-		STKHTNode<T> *_Table;
+		/**************************************************************************************************
+		* @brief	The buckets.
+		*
+		* ### summary	@brief	Head of each bucket's chain of nodes.
+		**************************************************************************************************/
+		STKHTNode<T> **_Table;
+
+
+		/**************************************************************************************************
+		* @brief	The old buckets.
+		*
+		* ### summary	@brief	Buckets from before the table last grew, NULL once they have all been moved.
+		**************************************************************************************************/
+		STKHTNode<T> **_OldTable;
+
+
+		/**************************************************************************************************
+		* @brief	The pointer cache.
+		*
+		* ### summary	@brief	Nodes of recently used string table keys, indexed by a hash of the key's address.
+		**************************************************************************************************/
+		STKHTNode<T> **_PtrCache;
+		unsigned int _PtrCacheShift;
 
 		/**************************************************************************************************
 		* @brief	Size of the height table.
@@ -182,6 +428,17 @@ namespace PSTD {
 		unsigned int _TableSize;
 
 
+		unsigned int _OldTableSize;
+
+
+		/**************************************************************************************************
+		* @brief	The rehash position.
+		*
+		* ### summary	@brief	Old buckets below this index have been moved to the current table.
+		**************************************************************************************************/
+		unsigned int _RehashPos;
+
+
 		unsigned int _OverflowAllocSize;
 
 
@@ -0,0 +1,138 @@
+/** \file SlabAllocator.h
+ *  \brief Size class based allocator for variable size objects
+ *
+ * Requests are rounded up to one of a set of size classes (16, 32, 48 ... 4096 bytes), each served by its own
+ * pool of fixed size chunks.  Larger requests fall back to the system allocator.
+ */
+
+#pragma once
+
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <stddef.h>
+#include <vector>
+#include <type_traits>
+
+
+#define SLAB_CLASS_GRANULARITY		16				// size difference between neighbouring size classes
+#define SLAB_MAX_SIZE				4096			// largest request served from a size class
+#define SLAB_NUM_CLASSES			(SLAB_MAX_SIZE / SLAB_CLASS_GRANULARITY)
+#define SLAB_ALIGNMENT				16				// alignment guaranteed for all slab allocations
+#define SLAB_DEFAULT_BLOCK_SIZE		(64 * 1024)		// default number of bytes requested from the system per block
+
+namespace PSTD {
+
+
+	/** \brief Pool of fixed size chunks for a single size class */
+	struct SlabClass {
+		unsigned int _ChunkSize;				// Size of each chunk, properly aligned to hold the object and the free list link
+		unsigned int _ObjPerBlock;				// Number of chunks in each block
+		unsigned int _NumAllocatedObj;			// Number of chunks currently handed out
+		char *_HeadIndex;						// The next available chunk
+		std::vector<char *> _BlockList;			// The collection of memory blocks used by this class
+	};
+
+
+	/** \brief Size class based allocator
+	 *
+	 * Like PoolMemManager the allocator is not thread safe.  Size classes are set up lazily the first time a
+	 * request of that size is made.
+	 */
+	class SlabAllocator {
+		public:
+
+		/** \brief Constructor
+		 * @param blockSize Approximate number of bytes each size class requests from the system when it grows
+		 */
+		SlabAllocator(unsigned int blockSize = SLAB_DEFAULT_BLOCK_SIZE);
+
+
+		//! Deconstructor, releases all memory handed out by the allocator
+		~SlabAllocator(void);
+
+
+		/** \brief Allocate memory
+		 * @param size Number of bytes to allocate
+		 * @return Memory aligned to at least SLAB_ALIGNMENT bytes
+		 */
+		void *Allocate(size_t size);
+
+
+		/** \brief Return memory to the allocator
+		 * @param ptr Memory previously returned by Allocate
+		 * @param size Size passed to Allocate for this memory
+		 */
+		void Free(void *ptr, size_t size);
+
+
+		/** \brief Get the chunk size used to satisfy a request
+		 * @param size Request size
+		 * @return Chunk size of the serving size class, or 0 if the request goes to the system allocator
+		 */
+		unsigned int Get_ChunkSize(size_t size);
+
+
+		/** \brief Get the number of chunks currently handed out across all size classes
+		 * @return Number of allocated chunks
+		 */
+		unsigned int Get_NumAllocatedObj(void);
+
+		private:
+		SlabAllocator(const SlabAllocator &);
+		SlabAllocator &operator=(const SlabAllocator &);
+
+		// set up the pool for a size class
+		SlabClass *Create_Class(unsigned int classIndex);
+
+		// grow a size class by another block of chunks
+		void Add_Block(SlabClass *sc);
+
+		unsigned int _BlockSize;							// Approximate number of bytes per block
+		SlabClass *_Classes[SLAB_NUM_CLASSES];				// Size classes indexed by (size - 1) / SLAB_CLASS_GRANULARITY
+	};
+
+
+	/** \brief Standard library compatible allocator drawing from a SlabAllocator
+	 *
+	 * Allows STL containers to take their nodes and buffers from a slab allocator, e.g.
+	 *   std::map<std::string, int, std::less<std::string>, SlabStdAllocator<std::pair<const std::string, int>>>
+	 * \tparam T Type of object to allocate
+	 */
+	template <typename T>
+	class SlabStdAllocator {
+		public:
+		typedef T value_type;
+		typedef T *pointer;
+		typedef const T *const_pointer;
+		typedef T &reference;
+		typedef const T &const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template <typename U> struct rebind { typedef SlabStdAllocator<U> other; };
+
+		SlabStdAllocator(SlabAllocator *slab) : _Slab(slab) {};
+
+		template <typename U>
+		SlabStdAllocator(const SlabStdAllocator<U> &other) : _Slab(other._Slab) {};
+
+		T *allocate(size_t n) {
+			static_assert(std::alignment_of<T>::value <= SLAB_ALIGNMENT, "Type alignment exceeds the slab alignment");
+			return (T *)_Slab->Allocate(n * sizeof(T));
+		};
+
+		void deallocate(T *ptr, size_t n) { _Slab->Free(ptr, n * sizeof(T)); };
+
+		template <typename U>
+		bool operator==(const SlabStdAllocator<U> &other) const { return _Slab == other._Slab; };
+
+		template <typename U>
+		bool operator!=(const SlabStdAllocator<U> &other) const { return _Slab != other._Slab; };
+
+		SlabAllocator *_Slab;
+	};
+
+}
+
+#endif
@@ -0,0 +1,514 @@
+/** \file UnrolledListPooled.hpp
+ *  \brief An unrolled linked list with pooled nodes
+ *
+ * Each node holds up to N elements in a contiguous array, so walking the list touches one node per N elements
+ * instead of chasing a pointer per element.  The list offers the same head, rear and cursor operations as
+ * SLListPooled.
+ */
+
+#ifndef UNROLLEDLISTPOOLED_H
+#define UNROLLEDLISTPOOLED_H
+
+#include <stddef.h>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "PooledMemManager.hpp"
+
+#define ULL_THREAD_POOL_SIZE	256				// nodes in each block of the per thread shared pool
+
+namespace PSTD {
+
+	/** \brief Node of an unrolled list holding up to N elements */
+	template <typename T, unsigned int N>
+	struct ULLNode {
+		unsigned int _Count;										// Number of elements in use, always at least 1 while linked
+		ULLNode *_NextNode;
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type _Data[N];
+
+		ULLNode(void) : _Count(0), _NextNode(NULL) {};
+
+		T *Get(unsigned int i) { return reinterpret_cast<T *>(&_Data[i]); };
+	};
+
+
+	/** \brief Forward iterator over the elements of an UnrolledListPooled
+	 * \tparam T Type of the list's elements
+	 * \tparam N Elements per node
+	 * \tparam V T for a mutable iterator, const T for a constant one
+	 */
+	template <typename T, unsigned int N, typename V>
+	class ULLIterator {
+		public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef ptrdiff_t difference_type;
+		typedef V *pointer;
+		typedef V &reference;
+
+		ULLIterator(void) : _Node(NULL), _Index(0) {};
+		explicit ULLIterator(ULLNode<T, N> *node, unsigned int index = 0) : _Node(node), _Index(index) {};
+
+		// mutable iterators convert to constant ones
+		ULLIterator(const ULLIterator<T, N, T> &it) : _Node(it.Get_Node()), _Index(it.Get_Index()) {};
+
+		V &operator*(void) const { return *_Node->Get(_Index); };
+		V *operator->(void) const { return _Node->Get(_Index); };
+
+		ULLIterator &operator++(void) {
+			if (++_Index == _Node->_Count) {
+				_Node = _Node->_NextNode;
+				_Index = 0;
+			}
+			return *this;
+		};
+
+		ULLIterator operator++(int) {
+			ULLIterator prev = *this;
+			++(*this);
+			return prev;
+		};
+
+		bool operator==(const ULLIterator &it) const { return (_Node == it._Node) && (_Index == it._Index); };
+		bool operator!=(const ULLIterator &it) const { return !(*this == it); };
+
+		ULLNode<T, N> *Get_Node(void) const { return _Node; };
+		unsigned int Get_Index(void) const { return _Index; };
+
+		private:
+		ULLNode<T, N> *_Node;
+		unsigned int _Index;
+	};
+
+
+	/** \brief Unrolled singly linked list with nodes allocated from a pool
+	 *
+	 * Inserting into a full node splits it in half, except at the ends of the list where a fresh node is started,
+	 * so lists built by appending keep their nodes full.  Deleting the rear is constant time unless it empties the
+	 * rear node.
+	 * \tparam T Type of the elements, which may be move only
+	 * \tparam N Number of elements per node
+	 */
+	template <typename T, unsigned int N>
+	class UnrolledListPooled {
+		static_assert(N > 0, "UnrolledListPooled needs at least one element per node");
+
+		public:
+		typedef ULLNode<T, N> Node;
+		typedef PoolMemManager<Node> NodePool;
+		typedef ULLIterator<T, N, T> iterator;
+		typedef ULLIterator<T, N, const T> const_iterator;
+		typedef T value_type;
+
+		/** \brief Constructor for a list with a pool of its own
+		 * @param poolSize Number of nodes in each block of the list's pool, which grows as needed
+		 */
+		UnrolledListPooled(unsigned int poolSize) :
+			_Head(NULL),
+			_Rear(NULL),
+			_PrevNode(NULL),
+			_CurNode(NULL),
+			_CurIndex(0),
+			_ListSize(0),
+			_CurListPos(-1),
+			_MemManager(new NodePool(poolSize, true)),
+			_Pool(_MemManager) { };
+
+		/** \brief Constructor for a list borrowing a pool owned elsewhere, which must outlive it
+		 * @param pool Pool to allocate nodes from
+		 */
+		explicit UnrolledListPooled(NodePool *pool) :
+			_Head(NULL),
+			_Rear(NULL),
+			_PrevNode(NULL),
+			_CurNode(NULL),
+			_CurIndex(0),
+			_ListSize(0),
+			_CurListPos(-1),
+			_MemManager(NULL),
+			_Pool(pool) { };
+
+		/** \brief Constructor for a list using the calling thread's shared pool
+		 *
+		 * The list must be emptied or destroyed on the thread which created it, before that thread exits.
+		 */
+		UnrolledListPooled(void) :
+			_Head(NULL),
+			_Rear(NULL),
+			_PrevNode(NULL),
+			_CurNode(NULL),
+			_CurIndex(0),
+			_ListSize(0),
+			_CurListPos(-1),
+			_MemManager(NULL),
+			_Pool(Get_ThreadPool()) { };
+
+		~UnrolledListPooled(void) {
+			Clear();
+			delete _MemManager;
+		};
+
+
+		/** \brief Get the node pool shared by all lists of this type created on the calling thread
+		 * @return The thread's pool
+		 */
+		static NodePool *Get_ThreadPool(void) {
+			static thread_local NodePool pool(ULL_THREAD_POOL_SIZE, true);
+			return &pool;
+		};
+
+
+		/** \brief Remove every element from the list */
+		void Clear(void) {
+			Node *node = _Head;
+			while (node) {
+				Node *next = node->_NextNode;
+				for (unsigned int i = 0; i < node->_Count; i++) {
+					node->Get(i)->~T();
+				}
+				Free_Node(node);
+				node = next;
+			}
+			_Head = _Rear = NULL;
+			_ListSize = 0;
+			Reset_List();
+		};
+
+		void Reset_List(void) {
+			_CurNode = _Head;
+			_CurIndex = 0;
+			_PrevNode = NULL;
+			_CurListPos = (_ListSize) ? 0 : -1;
+		};
+
+
+		void Insert_Head(T newdata) {
+			if (_ListSize == 0) {
+				Insert_First(std::move(newdata));
+			}
+			else {
+				Insert_At(NULL, _Head, 0, std::move(newdata), true);
+			}
+		};
+
+		void Insert_Rear(T newdata) {
+			if (_ListSize == 0) {
+				Insert_First(std::move(newdata));
+			}
+			else {
+				Insert_At(NULL, _Rear, _Rear->_Count, std::move(newdata), false);
+			}
+		};
+
+
+		void Insert_CurrentR(T newdata) {
+			if (_ListSize == 0) {
+				Insert_First(std::move(newdata));
+			}
+			else {
+				Insert_At(_PrevNode, _CurNode, _CurIndex + 1, std::move(newdata), false);
+			}
+		};
+
+
+		void Insert_CurrentF(T newdata) {
+			if (_ListSize == 0) {
+				Insert_First(std::move(newdata));
+			}
+			else {
+				Insert_At(_PrevNode, _CurNode, _CurIndex, std::move(newdata), true);
+			}
+		};
+
+
+		void Delete_Head(void) {
+			if (_ListSize == 0) {
+				return;
+			}
+
+			bool atCursor = (_CurListPos == 0);
+			Remove_At(NULL, _Head, 0);
+			if (atCursor) {
+				Reset_List();
+			}
+			else {
+				_CurListPos--;
+			}
+		};
+
+
+		/** \brief Delete the last element of the list
+		 *
+		 * If the cursor was on the rear it moves back one element.  A walk of the nodes is only needed when the
+		 * rear node is emptied.
+		 */
+		void Delete_Rear(void) {
+			if (_ListSize <= 1) {
+				Delete_Head();
+				return;
+			}
+
+			bool atCursor = (_CurListPos == (int)_ListSize - 1);
+			Node *prevCur = _PrevNode;
+			Node *prev = NULL;
+
+			// the rear node is about to empty, find the nodes before it
+			if (_Rear->_Count == 1) {
+				prevCur = NULL;
+				for (prev = _Head; prev->_NextNode != _Rear; prev = prev->_NextNode) {
+					prevCur = prev;
+				}
+			}
+
+			Remove_At(prev, _Rear, _Rear->_Count - 1);
+			if (atCursor) {
+				_CurNode = _Rear;
+				_CurIndex = _Rear->_Count - 1;
+				_PrevNode = prevCur;
+				_CurListPos--;
+			}
+		};
+
+
+		void Delete_Current(void) {
+			if (_ListSize == 0) {
+				return;
+			}
+			if (_CurListPos == 0) {
+				Delete_Head();
+				return;
+			}
+			if (_CurListPos == (int)_ListSize - 1) {
+				Delete_Rear();
+				return;
+			}
+
+			// the cursor moves on to the following element, which keeps its position
+			Remove_At(_PrevNode, _CurNode, _CurIndex);
+		};
+
+
+		bool Has_Data(void) { return _ListSize != 0; };
+
+
+		/** \brief Get the element at the cursor, the list must not be empty */
+		T &Get_Data(void) { return *_CurNode->Get(_CurIndex); };
+
+
+		/** \brief Get the first element, the list must not be empty */
+		T &Get_Head(void) { return *_Head->Get(0); };
+
+
+		bool Next_Node(void) {
+			if (_CurNode == NULL) {
+				return false;
+			}
+			if (_CurIndex + 1 < _CurNode->_Count) {
+				_CurIndex++;
+			}
+			else if (_CurNode->_NextNode) {
+				_PrevNode = _CurNode;
+				_CurNode = _CurNode->_NextNode;
+				_CurIndex = 0;
+			}
+			else {
+				return false;
+			}
+			_CurListPos++;
+			return true;
+		};
+
+
+		unsigned int Get_ListSize(void) { return _ListSize; };
+
+		bool Goto_Node(int seekpos) {
+
+			// check for valid positions
+			if ((seekpos < 0) || (seekpos >= (int)_ListSize)) {
+				return false;
+			}
+
+			// check to see if we have to back up
+			if (seekpos < _CurListPos) {
+				Reset_List();
+			}
+
+			// skip whole nodes until we reach the one holding the position
+			while (_CurListPos + (int)(_CurNode->_Count - _CurIndex) <= seekpos) {
+				_CurListPos += _CurNode->_Count - _CurIndex;
+				_PrevNode = _CurNode;
+				_CurNode = _CurNode->_NextNode;
+				_CurIndex = 0;
+			}
+			_CurIndex += seekpos - _CurListPos;
+			_CurListPos = seekpos;
+			return true;
+		};
+
+
+		int Get_CurrentPos(void) { return _CurListPos; };
+
+
+		iterator begin(void) { return iterator(_Head); };
+		iterator end(void) { return iterator(); };
+		const_iterator begin(void) const { return const_iterator(_Head); };
+		const_iterator end(void) const { return const_iterator(); };
+		const_iterator cbegin(void) const { return const_iterator(_Head); };
+		const_iterator cend(void) const { return const_iterator(); };
+
+		protected:
+		UnrolledListPooled(const UnrolledListPooled<T, N> &);
+		UnrolledListPooled<T, N> &operator=(const UnrolledListPooled<T, N> &);
+
+		void Insert_First(T &&newdata) {
+			_Head = _Rear = Allocate_Node();
+			new (_Head->Get(0)) T(std::move(newdata));
+			_Head->_Count = 1;
+			_ListSize = 1;
+			Reset_List();
+		};
+
+
+		Node *Allocate_Node(void) { return _Pool->Allocate_Object(); };
+
+		void Free_Node(Node *node) {
+			node->~Node();
+			_Pool->Free_Object(node);
+		};
+
+
+		// link an empty node in after prev, or at the head if prev is NULL
+		Node *Link_NewNode(Node *prev) {
+			Node *node = Allocate_Node();
+			Node *next = (prev) ? prev->_NextNode : _Head;
+
+			node->_NextNode = next;
+			if (prev) {
+				prev->_NextNode = node;
+			}
+			else {
+				_Head = node;
+			}
+			if (prev == _Rear) {
+				_Rear = node;
+			}
+			if ((_CurNode == next) && next) {
+				_PrevNode = node;
+			}
+			return node;
+		};
+
+
+		// move the upper half of a full node into a new node following it
+		void Split_Node(Node *node) {
+			Node *next = Link_NewNode(node);
+			unsigned int half = N / 2;
+
+			for (unsigned int i = half; i < N; i++) {
+				new (next->Get(i - half)) T(std::move(*node->Get(i)));
+				node->Get(i)->~T();
+			}
+			node->_Count = half;
+			next->_Count = N - half;
+
+			if ((_CurNode == node) && (_CurIndex >= half)) {
+				_PrevNode = node;
+				_CurNode = next;
+				_CurIndex -= half;
+			}
+		};
+
+
+		// insert an element at index idx of node, which follows prev, making room if it is full
+		void Insert_At(Node *prev, Node *node, unsigned int idx, T &&newdata, bool beforeCursor) {
+			if (node->_Count == N) {
+				if (idx == 0) {
+					node = Link_NewNode(prev);
+				}
+				else if (idx == N) {
+					node = Link_NewNode(node);
+					idx = 0;
+				}
+				else {
+					Split_Node(node);
+					if (idx > node->_Count) {
+						idx -= node->_Count;
+						node = node->_NextNode;
+					}
+				}
+			}
+
+			for (unsigned int i = node->_Count; i > idx; i--) {
+				new (node->Get(i)) T(std::move(*node->Get(i - 1)));
+				node->Get(i - 1)->~T();
+			}
+			new (node->Get(idx)) T(std::move(newdata));
+			node->_Count++;
+			_ListSize++;
+
+			if ((_CurNode == node) && (_CurIndex >= idx)) {
+				_CurIndex++;
+			}
+			if (beforeCursor) {
+				_CurListPos++;
+			}
+		};
+
+
+		// remove the element at index idx of node, which follows prev, unlinking the node if it empties
+		//  a cursor on the removed element moves on to the following one
+		void Remove_At(Node *prev, Node *node, unsigned int idx) {
+			bool atCursor = (_CurNode == node) && (_CurIndex == idx);
+
+			node->Get(idx)->~T();
+			for (unsigned int i = idx + 1; i < node->_Count; i++) {
+				new (node->Get(i - 1)) T(std::move(*node->Get(i)));
+				node->Get(i)->~T();
+			}
+			node->_Count--;
+			_ListSize--;
+
+			if ((_CurNode == node) && (_CurIndex > idx)) {
+				_CurIndex--;
+			}
+			else if (atCursor && (idx == node->_Count)) {
+				_PrevNode = node;
+				_CurNode = node->_NextNode;
+				_CurIndex = 0;
+			}
+
+			if (node->_Count == 0) {
+				if (prev) {
+					prev->_NextNode = node->_NextNode;
+				}
+				else {
+					_Head = node->_NextNode;
+				}
+				if (_Rear == node) {
+					_Rear = prev;
+				}
+				if (_PrevNode == node) {
+					_PrevNode = prev;
+				}
+				Free_Node(node);
+			}
+		};
+
+		// +ECM+
+
+		Node *_Head;
+		Node *_Rear;
+		Node *_PrevNode;						// Node before the one holding the cursor
+		Node *_CurNode;							// Node holding the cursor
+		unsigned int _CurIndex;					// Index of the cursor within its node
+		unsigned int _ListSize;
+		int _CurListPos;
+		NodePool *_MemManager;					// Pool owned by the list, NULL when it borrows one
+		NodePool *_Pool;						// Pool nodes are allocated from
+
+	};
+
+};
+
+#endif
@@ -0,0 +1 @@
+/root/repo/include/mixin/Logger.h
\ No newline at end of file
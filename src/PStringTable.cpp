@@ -9,40 +9,225 @@
 #include <stdlib.h>
 #include <stdio.h> 
 #include <cassert>
-#include "PStringTable.h"
+#include "PStringtable.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __SSE_AVAIL__
+#include <emmintrin.h>
+#endif
 
 
 using namespace std;
 using namespace PSTD;
 
+// index entries hold the low 32 bits of the hash above the string number, a number of ST_INVALID_NUM marks an empty slot
+#define ST_EMPTY_ENTRY		0xFFFFFFFFFFFFFFFFULL
+
+static inline uint64_t Make_Entry(uint32_t hash, unsigned int num) { return ((uint64_t)hash << 32) | num; }
+static inline uint32_t Get_EntryHash(uint64_t entry) { return (uint32_t)(entry >> 32); }
+static inline unsigned int Get_EntryNum(uint64_t entry) { return (unsigned int)entry; }
+
+
+#define ST_SCAN_BLOCK		16				// bytes Add_Buffer tests for terminators at once
+
+static inline unsigned int Get_LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return idx;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static inline void Prefetch(const void *p) {
+#ifdef __SSE_AVAIL__
+	_mm_prefetch((const char *)p, _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(p);
+#endif
+}
+
+
+// hands out the positions of the terminators in a buffer in order, finding those of a whole block with one compare
+struct STNulScanner {
+	STNulScanner(const char *buf, size_t size) : _Buf(buf), _Size(size), _Block(0) { _Mask = Scan(0); }
+
+	// position of the next terminator, the buffer size once there are none left
+	size_t Next(void) {
+		while (!_Mask) {
+			_Block += ST_SCAN_BLOCK;
+			if (_Block >= _Size) return _Size;
+			_Mask = Scan(_Block);
+		}
+		size_t nul = _Block + Get_LowestBit(_Mask);
+		_Mask &= _Mask - 1;
+		return nul;
+	}
+
+	uint32_t Scan(size_t block) const {
+#ifdef __SSE_AVAIL__
+		if (block + ST_SCAN_BLOCK <= _Size) {
+			__m128i bytes = _mm_loadu_si128((const __m128i *)(_Buf + block));
+			return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()));
+		}
+#endif
+		uint32_t mask = 0;
+		for (size_t i = 0; (i < ST_SCAN_BLOCK) && (block + i < _Size); i++) {
+			mask |= (uint32_t)(_Buf[block + i] == 0) << i;
+		}
+		return mask;
+	}
+
+	const char *_Buf;
+	size_t _Size;
+	size_t _Block;						// Start of the block _Mask belongs to
+	uint32_t _Mask;						// Terminators of the block not handed out yet
+};
+
+
+// Save_Table file layout, all offsets are from the start of the file and 8 byte aligned:
+//   STFileHeader
+//   STFileChunk for each chunk
+//   index entries, uint64_t each
+//   chunk contents
+#define ST_FILE_MAGIC		"PSTDSTRT"
+#define ST_FILE_VERSION		2
+#define ST_FILE_HASH_PROBE	"PSTDSTRT"			// hashed into _HashCheck, files written with another string hash are refused
+
+struct STFileHeader {
+	char _Magic[8];
+	uint32_t _Version;
+	uint32_t _ChunkShift;
+	uint32_t _NumChunks;
+	uint32_t _IndexSize;
+	uint32_t _NumKeys;
+	uint32_t _HeaderSize;				// sizeof(STFileHeader), catches layout differences between builds
+	uint64_t _IndexOffset;
+	uint64_t _FileSize;
+	uint64_t _HashCheck;				// Hash of ST_FILE_HASH_PROBE, the index is only valid for the same hash function
+};
+
+struct STFileChunk {
+	uint64_t _Offset;
+	uint64_t _Size;
+};
+
+
+// map a whole file privately, writes go to copies of the touched pages
+static void *Map_File(const char *fileName, size_t &size) {
+#ifdef _MSC_VER
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+
+	LARGE_INTEGER fileSize;
+	void *base = NULL;
+	if (GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart > 0)) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (mapping) {
+			base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+		size = (size_t)fileSize.QuadPart;
+	}
+	CloseHandle(file);
+	return base;
+#else
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) return NULL;
+
+	struct stat st;
+	void *base = NULL;
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+		size = (size_t)st.st_size;
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (base == MAP_FAILED) base = NULL;
+	}
+	close(fd);
+	return base;
+#endif
+}
+
+static void Unmap_File(void *base, size_t size) {
+#ifdef _MSC_VER
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+
+
+PStringTable::STIndex::STIndex(unsigned int size) : _Size(size), _Mapped(false) {
+	_Entries = new std::atomic<uint64_t>[_Size];
+	for (unsigned int i = 0; i < _Size; i++) {
+		_Entries[i].store(ST_EMPTY_ENTRY, std::memory_order_relaxed);
+	}
+}
+
+PStringTable::STIndex::STIndex(unsigned int size, std::atomic<uint64_t> *mapped) : _Size(size), _Entries(mapped), _Mapped(true) {}
+
+PStringTable::STIndex::~STIndex(void) {
+	if (!_Mapped) delete[]_Entries;
+}
+
+
 /*****************************************************************************************
  * +CM+ StringTable(size_t maxSize): Constructor which initializes string table ]
  *****************************************************************************************/
-PStringTable::PStringTable(unsigned int maxSize) :
-_STTableSize(maxSize),
-_HTTableSize(maxSize / 6),
-_HTOverflowPos(0),
+PStringTable::PStringTable(unsigned int maxSize, bool concurrent) :
+_NumChunks(0),
+_ChunkCapacity(16),
+_NumMappedChunks(0),
+_MapBase(NULL),
+_MapSize(0),
+_ChunkShift(0),
+_STCurrentIndex(0),
+_STTableSize(0),
 _HTNumKeys(0),
-_HTOverflowCnt(0)
+_Concurrent(concurrent)
 {
-  _STCurrentIndex = 0;
-  _StrBuffer = new char[_STTableSize];
-  _HashTable = new STNode[_HTTableSize];
-  _HTOverflowPos = ST_HT_ALLOC_SIZE;
+	while (((size_t)1 << _ChunkShift) < maxSize) _ChunkShift++;
+	while (((size_t)1 << _ChunkShift) < ST_MIN_CHUNK_SIZE) _ChunkShift++;
+	while (((size_t)1 << _ChunkShift) > ST_MAX_CHUNK_SIZE) _ChunkShift--;
+
+	// one index slot for every 6 bytes of expected strings, the index is kept under 3/4 full
+	unsigned int indexSize = ST_MIN_INDEX_SIZE;
+	while (indexSize < maxSize / 6) indexSize <<= 1;
+	_HashTable.store(new STIndex(indexSize), std::memory_order_relaxed);
+
+	_Chunks.store(new char *[_ChunkCapacity], std::memory_order_relaxed);
+	Add_Chunk((size_t)1 << _ChunkShift);
 }
 
 /****************************************************************************************
  * +CM+ ~StringTable(void): Deconstructor to free up memory used by string table ]
  ***************************************************************************************/
 PStringTable::~PStringTable(void) {
-	delete []_StrBuffer;
+	char **chunks = _Chunks.load(std::memory_order_relaxed);
+	for (unsigned int i = _NumMappedChunks; i < _NumChunks.load(std::memory_order_relaxed); i++) {
+		delete[] chunks[i];
+	}
+	delete[]chunks;
+	delete _HashTable.load(std::memory_order_relaxed);
 
-	size_t numOverflow = _HTOverflow.size();
-	for (size_t i = 0; i < numOverflow; i++) {
-		delete[] _HTOverflow[i];
+	for (size_t i = 0; i < _RetiredChunks.size(); i++) {
+		delete[]_RetiredChunks[i];
+	}
+	for (size_t i = 0; i < _RetiredIndex.size(); i++) {
+		delete _RetiredIndex[i];
 	}
 
-	delete[]_HashTable;
+	if (_MapBase) {
+		Unmap_File(_MapBase, _MapSize);
+	}
 }
 
 /****************************************************************************************
@@ -52,138 +237,432 @@ PStringTable::~PStringTable(void) {
  * Returns: (char *): Pointer to string in string table ]
  ***************************************************************************************/
 const char *PStringTable::Get_String(const char *sstring) {
-	size_t key = Hash(sstring) & (_HTTableSize - 1);
+	size_t len = strlen(sstring);
+	unsigned int num = Intern(sstring, len, Hash(sstring, len));
+	return (num == ST_INVALID_NUM) ? NULL : Get_String(num);
+}
+
+
+const char *PStringTable::Get_String(const std::string &sstring) {
+	return Get_String(sstring.c_str());
+}
+
+
+unsigned int PStringTable::Get_StringNum(const char *sstring) {
+	size_t len = strlen(sstring);
+	return Intern(sstring, len, Hash(sstring, len));
+}
+
+
+/****************************************************************************************
+ * +CM+ char *Get_String(int strnum): Get a string address of string strnum ]
+ * Parameters: strnum (int): String number to look up ]
+ * Returns: (const char *): Pointer to string in string table ]
+ ***************************************************************************************/
+const char *PStringTable::Get_String(unsigned int strnum) const {
+	assert((strnum >> _ChunkShift) < _NumChunks.load(std::memory_order_relaxed));
+	return _Chunks.load(std::memory_order_acquire)[strnum >> _ChunkShift] + (strnum & (((unsigned int)1 << _ChunkShift) - 1));
+}
 
-	if (_HashTable[key]._Key == NULL) {
-		char *res = &_StrBuffer[_STCurrentIndex];
-		_HashTable[key]._Key = res;
-		strcpy(res, sstring);
-		_STCurrentIndex += (strlen(sstring) + 1);
-		_HTNumKeys++;
-		return res;
+// Print the table
+void PStringTable::Display_Table(void) {
+	STIndex *index = _HashTable.load(std::memory_order_acquire);
+	unsigned int numStrings = 0;
+	unsigned int mask = ((unsigned int)1 << _ChunkShift) - 1;
+
+	// walk the index rather than the chunks, the unused tail of a full chunk holds no strings
+	for (unsigned int i = 0; i < index->_Size; i++) {
+		unsigned int num = Get_EntryNum(index->_Entries[i].load(std::memory_order_acquire));
+		if (num != ST_INVALID_NUM) {
+			printf("%u (chunk %u + %u) : %s\n", num, num >> _ChunkShift, num & mask, Get_String(num));
+			numStrings++;
+		}
 	}
+	printf("%u strings, %u chunks, %lu bytes\n", numStrings, _NumChunks.load(), (unsigned long)_STTableSize.load());
+}
 
-	STNode *node = &_HashTable[key];
 
-	// check for a matching key, if none exists add it to the string and hash table
-	do {
-		if (!strcmp(node->_Key, sstring)) {
-			return node->_Key;
+
+void PStringTable::Add_Buffer(const char *strBuf, int size) {
+	const char *strs[ST_BATCH_SIZE];
+	size_t lens[ST_BATCH_SIZE];
+	uint64_t hashes[ST_BATCH_SIZE];
+	STNulScanner scanner(strBuf, (size_t)size);
+	size_t bufferindex = 0;
+
+	while (bufferindex < (size_t)size) {
+
+		// split off a batch of strings
+		unsigned int cnt = 0;
+		for (; (cnt < ST_BATCH_SIZE) && (bufferindex < (size_t)size); cnt++) {
+			size_t nul = scanner.Next();
+			strs[cnt] = &strBuf[bufferindex];
+			lens[cnt] = nul - bufferindex;
+			bufferindex = nul + 1;
+		}
+
+		// hash the whole batch first, the hashes don't depend on each other so the CPU overlaps them, then start
+		//   loading the index slots they land in while the rest of the batch is looked up
+		for (unsigned int i = 0; i < cnt; i++) {
+			hashes[i] = Hash(strs[i], lens[i]);
 		}
-		if (node->_Next) {
-			node = node->_Next;
+		STIndex *index = _HashTable.load(std::memory_order_acquire);
+		for (unsigned int i = 0; i < cnt; i++) {
+			Prefetch(&index->_Entries[hashes[i] & (index->_Size - 1)]);
 		}
-	} while (node->_Next);
 
-	// out of overflow block size so make new one
-	if (_HTOverflowPos == ST_HT_ALLOC_SIZE) {
-		STNode *block = new STNode[ST_HT_ALLOC_SIZE];
-		_HTOverflow.push_back(block);
-		_HTOverflowPos = 0;
-		_HTOverflowCnt++;
+		for (unsigned int i = 0; i < cnt; i++) {
+			Intern(strs[i], lens[i], hashes[i]);
+		}
 	}
+}
+
+
+unsigned int PStringTable::Intern(const char *sstring, size_t len, uint64_t hash) {
 
-	// add the string to the next available bucket
-	char *res = &_StrBuffer[_STCurrentIndex];
-	strcpy(res, sstring);
-	_STCurrentIndex += (strlen(sstring) + 1);
-	_HTOverflow.back()[_HTOverflowPos]._Key = res;
-	node->_Next = &_HTOverflow.back()[_HTOverflowPos++];
-	_HTNumKeys++;
-	return res;
+	// strings already in the table are found without taking a lock
+	unsigned int num = Find_String(sstring, len, hash);
+	if (num != ST_INVALID_NUM) {
+		return num;
+	}
+
+	std::unique_lock<std::mutex> lock(_Stripes[hash & (ST_NUM_STRIPES - 1)]._Lock, std::defer_lock);
+	for (;;) {
+		if (_Concurrent) lock.lock();
+
+		// only Grow_Index replaces the index and it takes every stripe lock
+		STIndex *index = _HashTable.load(std::memory_order_acquire);
+		if ((size_t)(_HTNumKeys.load(std::memory_order_relaxed) + 1) * 4 > (size_t)index->_Size * 3) {
+			if (_Concurrent) lock.unlock();
+			Grow_Index(index);
+			continue;
+		}
+
+		// a string is only added under its stripe's lock, so another thread may have added this one since the search
+		//   but any entry appearing in the probe run from now on is a different string
+		unsigned int mask = index->_Size - 1;
+		unsigned int slot = (uint32_t)hash & mask;
+		uint64_t entry;
+		for (; Get_EntryNum(entry = index->_Entries[slot].load(std::memory_order_acquire)) != ST_INVALID_NUM; slot = (slot + 1) & mask) {
+			if ((Get_EntryHash(entry) == (uint32_t)hash) && Match_String(Get_EntryNum(entry), sstring, len, hash)) {
+				return Get_EntryNum(entry);
+			}
+		}
+
+		num = Store_String(sstring, len, hash);
+		if (num == ST_INVALID_NUM) {
+			return ST_INVALID_NUM;
+		}
+
+		// strings in other stripes may take the empty slot first
+		while (!index->_Entries[slot].compare_exchange_strong(entry, Make_Entry((uint32_t)hash, num), std::memory_order_release, std::memory_order_acquire)) {
+			do {
+				slot = (slot + 1) & mask;
+			} while (Get_EntryNum(entry = index->_Entries[slot].load(std::memory_order_acquire)) != ST_INVALID_NUM);
+		}
+		_HTNumKeys.fetch_add(1, std::memory_order_relaxed);
+		return num;
+	}
 }
 
 
-const char *PStringTable::Get_String(const std::string &sstring) {
-	return Get_String(sstring.c_str());
+unsigned int PStringTable::Find_String(const char *sstring, size_t len, uint64_t hash) const {
+	STIndex *index = _HashTable.load(std::memory_order_acquire);
+	unsigned int mask = index->_Size - 1;
+
+	for (unsigned int slot = (uint32_t)hash & mask;; slot = (slot + 1) & mask) {
+		uint64_t entry = index->_Entries[slot].load(std::memory_order_acquire);
+		unsigned int num = Get_EntryNum(entry);
+		if (num == ST_INVALID_NUM) {
+			return ST_INVALID_NUM;
+		}
+		if ((Get_EntryHash(entry) == (uint32_t)hash) && Match_String(num, sstring, len, hash)) {
+			return num;
+		}
+	}
 }
 
 
-unsigned int PStringTable::Get_StringNum(const char *sstring) {
-	size_t key = Hash(sstring) & (_HTTableSize - 1);
+bool PStringTable::Match_String(unsigned int num, const char *sstring, size_t len, uint64_t hash) const {
+	PInternedString str = Get_Interned(num);
+	return (str.Get_Hash() == hash) && (str.Get_Length() == len) && !memcmp(str.Get_String(), sstring, len);
+}
+
 
-	if (_HashTable[key]._Key == NULL) {
-		size_t index = _STCurrentIndex;
-		char *res = &_StrBuffer[index];
-		strcpy(res, sstring);
-		_STCurrentIndex += (strlen(sstring) + 1);
-		_HTNumKeys++;
-		return (unsigned int)index;
+unsigned int PStringTable::Store_String(const char *sstring, size_t len, uint64_t hash) {
+	size_t chunkSize = (size_t)1 << _ChunkShift;
+	size_t recordSize = (ST_HEADER_SIZE + len + 1 + (ST_RECORD_ALIGN - 1)) & ~(size_t)(ST_RECORD_ALIGN - 1);
+	uint32_t len32 = (uint32_t)len;
+	char *record;
+	unsigned int num;
+
+	// strings too long for a chunk get a chunk of their own and leave the current one in use
+	if (recordSize > chunkSize) {
+		std::unique_lock<std::mutex> lock(_StorageLock, std::defer_lock);
+		if (_Concurrent) lock.lock();
+
+		unsigned int chunk = Add_Chunk(recordSize);
+		if (chunk == ST_INVALID_NUM) {
+			return ST_INVALID_NUM;
+		}
+		record = _Chunks.load(std::memory_order_relaxed)[chunk];
+		num = chunk << _ChunkShift;
 	}
+	else {
+		uint64_t pos = _STCurrentIndex.load(std::memory_order_acquire);
+		for (;;) {
+			unsigned int chunk = (unsigned int)(pos >> 32);
+			size_t offset = (uint32_t)pos;
 
-	STNode *node = &_HashTable[key];
+			if (offset + recordSize <= chunkSize) {
+				if (_STCurrentIndex.compare_exchange_weak(pos, pos + recordSize, std::memory_order_acquire, std::memory_order_acquire)) {
+					record = _Chunks.load(std::memory_order_acquire)[chunk] + offset;
+					num = (chunk << _ChunkShift) | (unsigned int)offset;
+					break;
+				}
+				continue;
+			}
 
-	// check for a matching key, if none exists add it to the string and hash table
-	do {
-		if (!strcmp(node->_Key, sstring)) {
-			unsigned int index = (unsigned int)(node->_Key - _StrBuffer);
+			// the chunk is full, the first thread to get here starts the next one
+			std::unique_lock<std::mutex> lock(_StorageLock, std::defer_lock);
+			if (_Concurrent) lock.lock();
+
+			pos = _STCurrentIndex.load(std::memory_order_acquire);
+			if ((pos >> 32) == chunk) {
+				unsigned int next = Add_Chunk(chunkSize);
+				if (next == ST_INVALID_NUM) {
+					return ST_INVALID_NUM;
+				}
+				pos = (uint64_t)next << 32;
+				_STCurrentIndex.store(pos, std::memory_order_release);
+			}
 		}
-		if (node->_Next) {
-			node = node->_Next;
+	}
+
+	// [hash][length][string], the number refers to the string
+	memcpy(record, &hash, sizeof(hash));
+	memcpy(record + sizeof(hash), &len32, sizeof(len32));
+	memcpy(record + ST_HEADER_SIZE, sstring, len);
+	record[ST_HEADER_SIZE + len] = 0;
+	return num + ST_HEADER_SIZE;
+}
+
+
+unsigned int PStringTable::Add_Chunk(size_t size) {
+	unsigned int numChunks = _NumChunks.load(std::memory_order_relaxed);
+
+	// the chunk index has to fit in the bits of a string number above the offset
+	if ((size_t)numChunks + 1 >= ((size_t)1 << (32 - _ChunkShift))) {
+		return ST_INVALID_NUM;
+	}
+
+	// readers may still be using the full directory so it is replaced by a copy rather than reallocated
+	char **chunks = _Chunks.load(std::memory_order_relaxed);
+	if (numChunks == _ChunkCapacity) {
+		char **grown = new char *[_ChunkCapacity * 2];
+		memcpy(grown, chunks, _ChunkCapacity * sizeof(char *));
+		_ChunkCapacity *= 2;
+		_Chunks.store(grown, std::memory_order_release);
+		_RetiredChunks.push_back(chunks);
+		chunks = grown;
+	}
+
+	// zeroed so Save_Table never writes out stale heap contents from a chunk's unused tail
+	chunks[numChunks] = new char[size]();
+	_ChunkSizes.push_back(size);
+	_NumChunks.store(numChunks + 1, std::memory_order_release);
+	_STTableSize.fetch_add(size, std::memory_order_relaxed);
+	return numChunks;
+}
+
+
+void PStringTable::Grow_Index(STIndex *index) {
+	if (_Concurrent) {
+		for (unsigned int i = 0; i < ST_NUM_STRIPES; i++) _Stripes[i]._Lock.lock();
+	}
+
+	// another thread may have grown it while we waited for the locks
+	if (_HashTable.load(std::memory_order_relaxed) == index) {
+		STIndex *grown = new STIndex(index->_Size * 2);
+
+		// entries keep the string's hash so moving them doesn't touch the strings
+		unsigned int mask = grown->_Size - 1;
+		for (unsigned int i = 0; i < index->_Size; i++) {
+			uint64_t entry = index->_Entries[i].load(std::memory_order_relaxed);
+			if (Get_EntryNum(entry) != ST_INVALID_NUM) {
+				unsigned int slot = Get_EntryHash(entry) & mask;
+				while (Get_EntryNum(grown->_Entries[slot].load(std::memory_order_relaxed)) != ST_INVALID_NUM) slot = (slot + 1) & mask;
+				grown->_Entries[slot].store(entry, std::memory_order_relaxed);
+			}
 		}
-	} while (node->_Next);
+		_HashTable.store(grown, std::memory_order_release);
 
-	// out of overflow block size so make new one
-	if (_HTOverflowPos == ST_HT_ALLOC_SIZE) {
-		STNode *block = new STNode[ST_HT_ALLOC_SIZE];
-		_HTOverflow.push_back(block);
-		_HTOverflowPos = 0;
-		_HTOverflowCnt++;
+		if (_Concurrent) {
+			_RetiredIndex.push_back(index);
+		}
+		else {
+			delete index;
+		}
 	}
 
-	// add the string to the next available bucket
-	size_t index = _STCurrentIndex;
-	char *res = &_StrBuffer[index];
-	strcpy(res, sstring);
-	_STCurrentIndex += (strlen(sstring) + 1);
-	_HTOverflow.back()[_HTOverflowPos]._Key = res;
-	node->_Next = &_HTOverflow.back()[_HTOverflowPos++];
-	_HTNumKeys++;
-	return (unsigned int)index;
+	if (_Concurrent) {
+		for (unsigned int i = ST_NUM_STRIPES; i > 0; i--) _Stripes[i - 1]._Lock.unlock();
+	}
 }
 
 
-/****************************************************************************************
- * +CM+ char *Get_String(int strnum): Get a string address of string strnum ]
- * Parameters: strnum (int): String number to look up ]
- * Returns: (const char *): Pointer to string in string table ]
- ***************************************************************************************/
-const char *PStringTable::Get_String(unsigned int strnum) {
-	assert(strnum < _STTableSize);
-	return &_StrBuffer[strnum];
+bool PStringTable::Save_Table(const char *fileName) {
+	std::unique_lock<std::mutex> stripeLocks[ST_NUM_STRIPES];
+	std::unique_lock<std::mutex> storageLock(_StorageLock, std::defer_lock);
+	if (_Concurrent) {
+		for (unsigned int i = 0; i < ST_NUM_STRIPES; i++) stripeLocks[i] = std::unique_lock<std::mutex>(_Stripes[i]._Lock);
+		storageLock.lock();
+	}
+
+	STIndex *index = _HashTable.load(std::memory_order_acquire);
+	char **chunks = _Chunks.load(std::memory_order_acquire);
+	unsigned int numChunks = _NumChunks.load(std::memory_order_acquire);
+	uint64_t pos = _STCurrentIndex.load(std::memory_order_acquire);
+
+	STFileHeader header;
+	memcpy(header._Magic, ST_FILE_MAGIC, sizeof(header._Magic));
+	header._Version = ST_FILE_VERSION;
+	header._ChunkShift = _ChunkShift;
+	header._NumChunks = numChunks;
+	header._IndexSize = index->_Size;
+	header._NumKeys = _HTNumKeys.load(std::memory_order_relaxed);
+	header._HeaderSize = sizeof(STFileHeader);
+	header._IndexOffset = sizeof(STFileHeader) + (uint64_t)numChunks * sizeof(STFileChunk);
+
+	// only the used part of the current chunk is written, chunk sizes are multiples of the record alignment
+	std::vector<STFileChunk> chunkTable(numChunks);
+	uint64_t offset = header._IndexOffset + (uint64_t)index->_Size * sizeof(uint64_t);
+	for (unsigned int i = 0; i < numChunks; i++) {
+		chunkTable[i]._Offset = offset;
+		chunkTable[i]._Size = (i == (unsigned int)(pos >> 32)) ? (uint32_t)pos : _ChunkSizes[i];
+		offset += chunkTable[i]._Size;
+	}
+	header._FileSize = offset;
+	header._HashCheck = Hash(ST_FILE_HASH_PROBE, strlen(ST_FILE_HASH_PROBE));
+
+	std::vector<uint64_t> entries(index->_Size);
+	for (unsigned int i = 0; i < index->_Size; i++) {
+		entries[i] = index->_Entries[i].load(std::memory_order_relaxed);
+	}
+
+	FILE *file = fopen(fileName, "wb");
+	if (!file) {
+		return false;
+	}
+	bool written = (fwrite(&header, sizeof(header), 1, file) == 1);
+	if (numChunks) {
+		written = written && (fwrite(&chunkTable[0], sizeof(STFileChunk), numChunks, file) == numChunks);
+	}
+	written = written && (fwrite(&entries[0], sizeof(uint64_t), entries.size(), file) == entries.size());
+	for (unsigned int i = 0; written && (i < numChunks); i++) {
+		written = (fwrite(chunks[i], 1, (size_t)chunkTable[i]._Size, file) == chunkTable[i]._Size);
+	}
+	return (fclose(file) == 0) && written;
 }
 
-// Print the table
-void PStringTable::Display_Table(void) {
-	for (unsigned int i = 0; i < 20; i++) {
-		printf("%d\n", _StrBuffer[i]);
+
+bool PStringTable::Map_Table(const char *fileName) {
+	// a table mapped from an empty file has no keys but its chunks belong to the mapping
+	if ((_HTNumKeys.load(std::memory_order_relaxed) != 0) || _MapBase) {
+		return false;
+	}
+
+	size_t size = 0;
+	char *base = (char *)Map_File(fileName, size);
+	if (!base) {
+		return false;
+	}
+
+	// check the header and that everything it points to lies within the file
+	const STFileHeader *header = (const STFileHeader *)base;
+	const STFileChunk *chunkTable = (const STFileChunk *)(base + sizeof(STFileHeader));
+	bool valid = (size >= sizeof(STFileHeader)) && !memcmp(header->_Magic, ST_FILE_MAGIC, sizeof(header->_Magic)) &&
+		(header->_Version == ST_FILE_VERSION) && (header->_HeaderSize == sizeof(STFileHeader)) && (header->_FileSize == size) &&
+		(header->_ChunkShift >= 12) && (header->_ChunkShift < 32) &&
+		((uint64_t)header->_NumChunks + 1 < ((uint64_t)1 << (32 - header->_ChunkShift))) &&
+		(header->_IndexSize >= ST_MIN_INDEX_SIZE) && !(header->_IndexSize & (header->_IndexSize - 1)) &&
+		((uint64_t)header->_NumKeys * 4 <= (uint64_t)header->_IndexSize * 3) &&
+		(header->_IndexOffset == sizeof(STFileHeader) + (uint64_t)header->_NumChunks * sizeof(STFileChunk)) &&
+		(header->_IndexOffset + (uint64_t)header->_IndexSize * sizeof(uint64_t) <= size) &&
+		(header->_HashCheck == Hash(ST_FILE_HASH_PROBE, strlen(ST_FILE_HASH_PROBE)));
+
+	// chunks follow the index in order without overlapping it or each other
+	uint64_t chunkStart = (valid) ? header->_IndexOffset + (uint64_t)header->_IndexSize * sizeof(uint64_t) : 0;
+	for (unsigned int i = 0; valid && (i < header->_NumChunks); i++) {
+		valid = !(chunkTable[i]._Offset & (ST_RECORD_ALIGN - 1)) && (chunkTable[i]._Offset >= chunkStart) &&
+			(chunkTable[i]._Offset <= size) && (chunkTable[i]._Size <= size - chunkTable[i]._Offset);
+		chunkStart = chunkTable[i]._Offset + chunkTable[i]._Size;
 	}
-	for (size_t i = 0; i < _STTableSize; i++) {
-		printf("%u : %s\n", i, &_StrBuffer[i]);
-		i += strlen(&_StrBuffer[i]);
-		if ((i + 1) >= _STCurrentIndex) {
-			i = _STTableSize;
+
+	// every index entry has to name a whole record inside its chunk whose hash agrees with the entry
+	const uint64_t *entries = (const uint64_t *)(base + ((valid) ? header->_IndexOffset : 0));
+	unsigned int offsetMask = (valid) ? ((unsigned int)1 << header->_ChunkShift) - 1 : 0;
+	unsigned int numKeys = 0;
+	for (unsigned int i = 0; valid && (i < header->_IndexSize); i++) {
+		unsigned int num = Get_EntryNum(entries[i]);
+		if (num == ST_INVALID_NUM) {
+			continue;
 		}
+		unsigned int chunk = num >> header->_ChunkShift;
+		uint64_t offset = num & offsetMask;
+		valid = (chunk < header->_NumChunks) && (offset >= ST_HEADER_SIZE) && !((offset - ST_HEADER_SIZE) & (ST_RECORD_ALIGN - 1)) &&
+			(offset < chunkTable[chunk]._Size);
+		if (valid) {
+			const char *str = base + chunkTable[chunk]._Offset + offset;
+			uint64_t hash;
+			uint32_t len;
+			memcpy(&hash, str - ST_HEADER_SIZE, sizeof(hash));
+			memcpy(&len, str - sizeof(len), sizeof(len));
+			valid = (offset + len < chunkTable[chunk]._Size) && !str[len] && ((uint32_t)hash == Get_EntryHash(entries[i]));
+		}
+		numKeys++;
+	}
+	valid = valid && (numKeys == header->_NumKeys);
+	if (!valid) {
+		Unmap_File(base, size);
+		return false;
 	}
-}
 
+	// drop the empty storage and index the table was constructed with
+	char **chunks = _Chunks.load(std::memory_order_relaxed);
+	for (unsigned int i = 0; i < _NumChunks.load(std::memory_order_relaxed); i++) {
+		delete[] chunks[i];
+	}
+	delete[]chunks;
+	delete _HashTable.load(std::memory_order_relaxed);
+	_ChunkSizes.clear();
+	_STTableSize.store(0, std::memory_order_relaxed);
 
+	// the mapped chunks are used in place, strings added later start a heap chunk after them
+	_ChunkShift = header->_ChunkShift;
+	_ChunkCapacity = 16;
+	while (_ChunkCapacity <= header->_NumChunks) _ChunkCapacity <<= 1;
+	chunks = new char *[_ChunkCapacity];
+	for (unsigned int i = 0; i < header->_NumChunks; i++) {
+		chunks[i] = base + chunkTable[i]._Offset;
+		_ChunkSizes.push_back((size_t)chunkTable[i]._Size);
+		_STTableSize.fetch_add((size_t)chunkTable[i]._Size, std::memory_order_relaxed);
+	}
+	_Chunks.store(chunks, std::memory_order_release);
+	_NumChunks.store(header->_NumChunks, std::memory_order_release);
+	_NumMappedChunks = header->_NumChunks;
 
-void PStringTable::Add_Buffer(const char *strBuf, int size) {
-  size_t bufferindex = 0;
-  
-	// go through each string in the buffer and try to add it
-	while (bufferindex != size) {
-		Get_String(&strBuf[bufferindex]);
-		bufferindex += (strlen(&strBuf[bufferindex]) + 1);
-	}
-}
-      
-size_t PStringTable::Hash(const char *key) const {
-	unsigned long hashval = 5381;
-	int c;
-
-	while ((c = *key++))
-		hashval = ((hashval << 5) + hashval) + c;
-	return hashval = hashval & (_HTTableSize - 1);
-}
\ No newline at end of file
+	static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "index entries are mapped as atomics");
+	_HashTable.store(new STIndex(header->_IndexSize, (std::atomic<uint64_t> *)(base + header->_IndexOffset)), std::memory_order_release);
+	_HTNumKeys.store(header->_NumKeys, std::memory_order_relaxed);
+
+	_STCurrentIndex.store((uint64_t)Add_Chunk((size_t)1 << _ChunkShift) << 32, std::memory_order_release);
+	_MapBase = base;
+	_MapSize = size;
+	return true;
+}
+
+
+uint64_t PStringTable::Hash(const char *key, size_t len) const {
+	return PInternedString::Hash_String(key, len);
+}
@@ -0,0 +1,138 @@
+/** \file SlabAllocator.cpp
+ *  \brief Size class based allocator for variable size objects
+ *
+ * Implementation of the slab allocator
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include "SlabAllocator.h"
+#include "PMath.h"
+
+using namespace PSTD;
+
+
+SlabAllocator::SlabAllocator(unsigned int blockSize) :
+_BlockSize(blockSize)
+{
+	memset(_Classes, 0, sizeof(_Classes));
+}
+
+
+SlabAllocator::~SlabAllocator(void) {
+	for (unsigned int i = 0; i < SLAB_NUM_CLASSES; i++) {
+		if (_Classes[i]) {
+			for (size_t j = 0; j < _Classes[i]->_BlockList.size(); j++) {
+				delete[]_Classes[i]->_BlockList[j];
+			}
+			delete _Classes[i];
+		}
+	}
+}
+
+
+void *SlabAllocator::Allocate(size_t size) {
+
+	// oversized requests go straight to the system allocator
+	if (size > SLAB_MAX_SIZE) {
+		return ::operator new(size);
+	}
+
+	unsigned int classIndex = (size) ? (unsigned int)((size - 1) / SLAB_CLASS_GRANULARITY) : 0;
+	SlabClass *sc = _Classes[classIndex];
+	if (!sc) {
+		sc = Create_Class(classIndex);
+	}
+
+	if (sc->_HeadIndex == NULL) {
+		Add_Block(sc);
+	}
+
+	char *chunk = sc->_HeadIndex;
+	sc->_HeadIndex = *(char **)chunk;
+	sc->_NumAllocatedObj++;
+	return chunk;
+}
+
+
+void SlabAllocator::Free(void *ptr, size_t size) {
+	if (!ptr) {
+		return;
+	}
+
+	if (size > SLAB_MAX_SIZE) {
+		::operator delete(ptr);
+		return;
+	}
+
+	// the chunk becomes the new front of its class's free list
+	SlabClass *sc = _Classes[(size) ? ((size - 1) / SLAB_CLASS_GRANULARITY) : 0];
+	*(char **)ptr = sc->_HeadIndex;
+	sc->_HeadIndex = (char *)ptr;
+	sc->_NumAllocatedObj--;
+}
+
+
+unsigned int SlabAllocator::Get_ChunkSize(size_t size) {
+	if (size > SLAB_MAX_SIZE) {
+		return 0;
+	}
+
+	unsigned int classIndex = (size) ? (unsigned int)((size - 1) / SLAB_CLASS_GRANULARITY) : 0;
+	SlabClass *sc = _Classes[classIndex];
+	if (!sc) {
+		sc = Create_Class(classIndex);
+	}
+	return sc->_ChunkSize;
+}
+
+
+unsigned int SlabAllocator::Get_NumAllocatedObj(void) {
+	unsigned int cnt = 0;
+	for (unsigned int i = 0; i < SLAB_NUM_CLASSES; i++) {
+		if (_Classes[i]) {
+			cnt += _Classes[i]->_NumAllocatedObj;
+		}
+	}
+	return cnt;
+}
+
+
+SlabClass *SlabAllocator::Create_Class(unsigned int classIndex) {
+	SlabClass *sc = new SlabClass();
+
+	// chunks must hold the largest request of the class and the free list link while staying aligned
+	std::vector<unsigned int> memSizes;
+	memSizes.push_back(SLAB_ALIGNMENT);
+	memSizes.push_back((classIndex + 1) * SLAB_CLASS_GRANULARITY);
+	memSizes.push_back(std::alignment_of<char *>::value);
+	memSizes.push_back(sizeof(char *));
+
+	sc->_ChunkSize = PSTD::PMath::LCM(memSizes);
+	sc->_ObjPerBlock = (_BlockSize > sc->_ChunkSize) ? (_BlockSize / sc->_ChunkSize) : 1;
+	sc->_NumAllocatedObj = 0;
+	sc->_HeadIndex = NULL;
+
+	_Classes[classIndex] = sc;
+	return sc;
+}
+
+
+void SlabAllocator::Add_Block(SlabClass *sc) {
+	char *block = new char[sc->_ObjPerBlock * sc->_ChunkSize + SLAB_ALIGNMENT];
+	sc->_BlockList.push_back(block);
+
+	// compute the point where we should start in the buffer so that memory is aligned
+	char *start = block;
+	while (((uintptr_t)start) & (SLAB_ALIGNMENT - 1)) {
+		start++;
+	}
+
+	// interleave pointers to the next chunk in memory and put the block in front of the free list
+	for (unsigned int i = 0; i < sc->_ObjPerBlock - 1; i++) {
+		*(char **)(&start[i * sc->_ChunkSize]) = &start[(i + 1) * sc->_ChunkSize];
+	}
+	*(char **)(&start[(sc->_ObjPerBlock - 1) * sc->_ChunkSize]) = sc->_HeadIndex;
+	sc->_HeadIndex = start;
+}
@@ -0,0 +1,90 @@
+/** \file PConcurrentHashMap_Threads.cpp
+ *  \brief Threaded smoke test of PConcurrentHashMap, meant to be run under ThreadSanitizer
+ *
+ * g++ -std=c++11 -g -O1 -fsanitize=thread -I../include PConcurrentHashMap_Threads.cpp -o chm_threads -pthread
+ *
+ * Writers set, replace and remove keys of overlapping ranges while readers look them up.  Every value is
+ * written as a pair whose halves agree, so a reader that trusted a torn copy of a slot sees a mismatch.  Few
+ * shards and an empty start make the shards grow while readers are walking them.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "PConcurrentHashMap.hpp"
+
+
+#define NUM_READERS		4
+#define NUM_WRITERS		3
+#define NUM_KEYS		4000
+#define NUM_WRITES		40000			// per writer
+
+struct TestVal {
+	long _Key;
+	long _Check;						// _Key * 3, catches torn reads
+};
+
+
+int main(void) {
+	PSTD::PConcurrentHashMap<long, TestVal> map(0, 8);
+	std::atomic<bool> stop(false);
+	std::atomic<int> errors(0);
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < NUM_READERS; r++) {
+		readers.push_back(std::thread([&]() {
+			while (!stop.load(std::memory_order_relaxed)) {
+				for (long key = 0; key < NUM_KEYS; key += 7) {
+					TestVal val;
+					if (map.Get(key, val) && ((val._Key % NUM_KEYS != key) || (val._Check != val._Key * 3))) {
+						errors++;
+					}
+				}
+			}
+		}));
+	}
+
+	std::vector<std::thread> writers;
+	for (int w = 0; w < NUM_WRITERS; w++) {
+		writers.push_back(std::thread([&, w]() {
+			for (long i = 0; i < NUM_WRITES; i++) {
+				long key = (i * 7 + w) % NUM_KEYS;
+				if (i % 5 == 4) {
+					map.Remove(key);
+				}
+				else {
+					TestVal val;
+					val._Key = key + NUM_KEYS * (i % 50);
+					val._Check = val._Key * 3;
+					map.Set(key, val);
+				}
+			}
+		}));
+	}
+	for (int w = 0; w < NUM_WRITERS; w++) {
+		writers[w].join();
+	}
+
+	// with the writers done a snapshot taken while readers still run must match the map
+	std::vector<std::pair<long, TestVal>> snapshot;
+	map.Take_Snapshot(snapshot);
+	if (snapshot.size() != map.Get_NumKeys()) {
+		errors++;
+	}
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		TestVal val;
+		if (!map.Get(snapshot[i].first, val) || (val._Key != snapshot[i].second._Key)) {
+			errors++;
+		}
+	}
+
+	stop.store(true, std::memory_order_relaxed);
+	for (int r = 0; r < NUM_READERS; r++) {
+		readers[r].join();
+	}
+
+	printf("PConcurrentHashMap threads: %s (%u keys)\n", (errors.load()) ? "FAILED" : "ok", map.Get_NumKeys());
+	return (errors.load()) ? 1 : 0;
+}
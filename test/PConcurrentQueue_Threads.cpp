@@ -0,0 +1,100 @@
+/** \file PConcurrentQueue_Threads.cpp
+ *  \brief Threaded smoke test of PMPSCQueue and PSPSCRing, meant to be run under ThreadSanitizer
+ *
+ * g++ -std=c++11 -g -O1 -fsanitize=thread -I../include PConcurrentQueue_Threads.cpp -o queue_threads -pthread
+ *
+ * Producers tag each element with their id and a sequence number, and the consumer checks that every element
+ * arrives exactly once and that each producer's elements arrive in order.
+ */
+
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PConcurrentQueue.hpp"
+
+
+#define NUM_PRODUCERS		4
+#define NUM_ITEMS			20000			// per producer
+
+
+static int Test_MPSCQueue(void) {
+	PSTD::PMPSCQueue<long> queue(256);
+	std::vector<std::thread> producers;
+	for (long p = 0; p < NUM_PRODUCERS; p++) {
+		producers.push_back(std::thread([&queue, p]() {
+			for (long i = 0; i < NUM_ITEMS; i++) {
+				while (!queue.Enqueue(p * NUM_ITEMS + i)) {
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	int errors = 0;
+	std::vector<long> next(NUM_PRODUCERS, 0);
+	for (long received = 0; received < (long)NUM_PRODUCERS * NUM_ITEMS;) {
+		long value;
+		if (!queue.Try_Dequeue(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		long p = value / NUM_ITEMS;
+		if ((p < 0) || (p >= NUM_PRODUCERS) || (value % NUM_ITEMS != next[p])) {
+			errors++;
+		}
+		else {
+			next[p]++;
+		}
+		received++;
+	}
+	for (int p = 0; p < NUM_PRODUCERS; p++) {
+		producers[p].join();
+	}
+	if (!queue.Is_Empty()) {
+		errors++;
+	}
+	return errors;
+}
+
+
+// strings make sure elements are constructed and moved on the right side of the indices
+static int Test_SPSCRing(void) {
+	PSTD::PSPSCRing<std::string> ring(64);
+	std::thread producer([&ring]() {
+		for (int i = 0; i < NUM_ITEMS; i++) {
+			std::string value = std::to_string(i);
+			while (!ring.Try_Enqueue(value)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	int errors = 0;
+	for (int i = 0; i < NUM_ITEMS;) {
+		std::string value;
+		if (!ring.Try_Dequeue(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		if (value != std::to_string(i)) {
+			errors++;
+		}
+		i++;
+	}
+	producer.join();
+	if (ring.Get_Size()) {
+		errors++;
+	}
+	return errors;
+}
+
+
+int main(void) {
+	int mpscErrors = Test_MPSCQueue();
+	int spscErrors = Test_SPSCRing();
+
+	printf("PMPSCQueue threads: %s\n", (mpscErrors) ? "FAILED" : "ok");
+	printf("PSPSCRing threads: %s\n", (spscErrors) ? "FAILED" : "ok");
+	return (mpscErrors || spscErrors) ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+/** \file PStringTable_Map.cpp
+ *  \brief Test of saving a PStringTable and mapping it back
+ *
+ * g++ -std=c++11 -g -O1 -fsanitize=address,undefined -I../include PStringTable_Map.cpp ../src/PStringTable.cpp -o st_map -pthread
+ *
+ * Covers a round trip of a filled table, strings added on top of a mapping, and tables which must refuse a
+ * mapping: one holding strings and one which is already mapped, including a mapping of an empty table.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "PStringtable.h"
+
+
+#define NUM_STRINGS		5000
+
+static int _Errors = 0;
+
+static void Check(bool ok, const char *what) {
+	if (!ok) {
+		printf("failed: %s\n", what);
+		_Errors++;
+	}
+}
+
+
+int main(void) {
+	const char *fileName = "st_map_test.bin";
+	const char *emptyName = "st_map_empty.bin";
+
+	{
+		PSTD::PStringTable table(64);
+		for (int i = 0; i < NUM_STRINGS; i++) {
+			table.Get_String("str_" + std::to_string(i));
+		}
+		Check(table.Save_Table(fileName), "save");
+
+		PSTD::PStringTable empty(64);
+		Check(empty.Save_Table(emptyName), "save empty");
+	}
+
+	// round trip, then add strings which go to heap chunks after the mapped ones
+	{
+		PSTD::PStringTable table(64);
+		Check(table.Map_Table(fileName), "map");
+		Check(table.Get_NumString() == NUM_STRINGS, "mapped string count");
+		for (int i = 0; i < NUM_STRINGS; i++) {
+			std::string str = "str_" + std::to_string(i);
+			const char *found = table.Get_String(str);
+			Check(found && !strcmp(found, str.c_str()) && (table.Get_String(table.Get_StringNum(found)) == found), "mapped string");
+		}
+		Check(table.Get_NumString() == NUM_STRINGS, "lookups added nothing");
+		Check(!strcmp(table.Get_String("added"), "added"), "add after map");
+		Check(!table.Map_Table(fileName), "map twice");
+	}
+
+	// a table mapped from an empty file has no keys but must still refuse a second mapping
+	{
+		PSTD::PStringTable table(64);
+		Check(table.Map_Table(emptyName), "map empty");
+		Check(!table.Map_Table(emptyName), "map empty twice");
+		Check(!table.Map_Table(fileName), "map over empty mapping");
+		Check(!strcmp(table.Get_String("added"), "added"), "add after empty map");
+	}
+
+	{
+		PSTD::PStringTable table(64);
+		table.Get_String("x");
+		Check(!table.Map_Table(fileName), "map into a filled table");
+		Check(!table.Map_Table("st_map_missing.bin"), "map a missing file");
+	}
+
+	remove(fileName);
+	remove(emptyName);
+	printf("PStringTable map: %s\n", (_Errors) ? "FAILED" : "ok");
+	return (_Errors) ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+/** \file PStringTable_Threads.cpp
+ *  \brief Threaded smoke test of a concurrent PStringTable, meant to be run under ThreadSanitizer
+ *
+ * g++ -std=c++11 -g -O1 -fsanitize=thread -I../include PStringTable_Threads.cpp ../src/PStringTable.cpp -o st_threads -pthread
+ *
+ * Threads intern the same strings in different orders, starting from a small table so the index, the chunk
+ * directory and the storage all grow while other threads read them.  Every thread must get the same pointer
+ * for a string and string numbers must round trip.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PStringtable.h"
+
+
+#define NUM_THREADS		6
+#define NUM_STRINGS		20000
+
+
+int main(void) {
+	PSTD::PStringTable table(64, true);
+	std::atomic<int> errors(0);
+
+	// a few strings larger than a chunk take the separate large string path
+	std::vector<std::string> strings;
+	for (int i = 0; i < NUM_STRINGS; i++) {
+		strings.push_back("ident_" + std::to_string(i) + ((i % 997) ? std::string() : std::string(6000, 'z')));
+	}
+
+	std::vector<std::vector<const char *>> found(NUM_THREADS, std::vector<const char *>(NUM_STRINGS));
+	std::vector<std::thread> threads;
+	for (int t = 0; t < NUM_THREADS; t++) {
+		threads.push_back(std::thread([&, t]() {
+			for (int k = 0; k < NUM_STRINGS; k++) {
+				int i = (k * 7 + t * 13) % NUM_STRINGS;
+				const char *str = table.Get_String(strings[i]);
+				found[t][i] = str;
+				if (!str || (table.Get_String(table.Get_StringNum(str)) != str)) {
+					errors++;
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < NUM_THREADS; t++) {
+		threads[t].join();
+	}
+
+	for (int i = 0; i < NUM_STRINGS; i++) {
+		for (int t = 1; t < NUM_THREADS; t++) {
+			if (found[t][i] != found[0][i]) {
+				errors++;
+			}
+		}
+		if (!found[0][i] || strcmp(found[0][i], strings[i].c_str())) {
+			errors++;
+		}
+	}
+	if (table.Get_NumString() != NUM_STRINGS) {
+		errors++;
+	}
+
+	printf("PStringTable threads: %s (%u strings)\n", (errors.load()) ? "FAILED" : "ok", table.Get_NumString());
+	return (errors.load()) ? 1 : 0;
+}
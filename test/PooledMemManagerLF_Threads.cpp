@@ -0,0 +1,102 @@
+/** \file PooledMemManagerLF_Threads.cpp
+ *  \brief Threaded smoke test of PoolMemManagerLF, meant to be run under ThreadSanitizer
+ *
+ * g++ -std=c++11 -g -O1 -fsanitize=thread -DLINUX -I../include PooledMemManagerLF_Threads.cpp -o lf_threads -pthread
+ *
+ * Threads allocate and free batches concurrently, some handing their objects to a neighbour to free, while the
+ * pool grows.  Every object must be exclusively owned while allocated and all chunks must be free at the end.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include "PooledMemManagerLF.hpp"
+
+
+#define NUM_THREADS		8
+#define NUM_ROUNDS		500
+#define BATCH_SIZE		64
+
+struct TestObj {
+	int _Owner;
+	int _Round;
+};
+
+
+int main(void) {
+	PSTD::PoolMemManagerLF<TestObj> pool(32, true);
+	std::atomic<int> errors(0);
+
+	// handoff[i] carries objects from thread i to thread i + 1, which frees them
+	std::vector<std::vector<TestObj *>> handoff(NUM_THREADS);
+	std::vector<std::atomic<bool>> ready(NUM_THREADS);
+	for (int i = 0; i < NUM_THREADS; i++) {
+		ready[i].store(false);
+	}
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < NUM_THREADS; t++) {
+		threads.push_back(std::thread([&, t]() {
+			std::vector<TestObj *> objs;
+			for (int round = 0; round < NUM_ROUNDS; round++) {
+				for (int i = 0; i < BATCH_SIZE; i++) {
+					TestObj *obj = pool.Allocate_Object();
+					if (!obj) {
+						errors++;
+						continue;
+					}
+					obj->_Owner = t;
+					obj->_Round = round;
+					objs.push_back(obj);
+				}
+				for (size_t i = 0; i < objs.size(); i++) {
+					if ((objs[i]->_Owner != t) || (objs[i]->_Round != round)) {
+						errors++;
+					}
+				}
+
+				// every few rounds the batch is freed by the next thread instead
+				if (!(round % 8) && !ready[t].load(std::memory_order_acquire)) {
+					handoff[t].swap(objs);
+					ready[t].store(true, std::memory_order_release);
+				}
+				for (size_t i = 0; i < objs.size(); i++) {
+					pool.Free_Object(objs[i]);
+				}
+				objs.clear();
+
+				int prev = (t + NUM_THREADS - 1) % NUM_THREADS;
+				if (ready[prev].load(std::memory_order_acquire)) {
+					for (size_t i = 0; i < handoff[prev].size(); i++) {
+						pool.Free_Object(handoff[prev][i]);
+					}
+					handoff[prev].clear();
+					ready[prev].store(false, std::memory_order_release);
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < NUM_THREADS; t++) {
+		threads[t].join();
+	}
+	for (int t = 0; t < NUM_THREADS; t++) {
+		for (size_t i = 0; i < handoff[t].size(); i++) {
+			pool.Free_Object(handoff[t][i]);
+		}
+	}
+
+	// every chunk is back on the free list exactly once
+	std::set<TestObj *> chunks;
+	unsigned int capacity = pool.Get_Capacity();
+	for (unsigned int i = 0; i < capacity; i++) {
+		chunks.insert(pool.Allocate_Object());
+	}
+	if ((chunks.size() != capacity) || chunks.count(NULL)) {
+		errors++;
+	}
+
+	printf("PoolMemManagerLF threads: %s (capacity %u)\n", (errors.load()) ? "FAILED" : "ok", capacity);
+	return (errors.load()) ? 1 : 0;
+}
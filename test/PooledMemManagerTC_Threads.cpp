@@ -0,0 +1,121 @@
+/** \file PooledMemManagerTC_Threads.cpp
+ *  \brief Threaded smoke test of PoolMemManagerTC, meant to be run under ThreadSanitizer
+ *
+ * g++ -std=c++11 -g -O1 -fsanitize=thread -I../include PooledMemManagerTC_Threads.cpp -o tc_threads -pthread
+ *
+ * More threads than PMM_TC_MAX_THREADS are kept alive at once so some of them work directly against the depot.
+ * Every thread allocates batches, hands part of each to its neighbour to free and frees what it is handed, while
+ * the pool grows.  Every object must be exclusively owned while allocated.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PooledMemManagerTC.hpp"
+
+
+#define NUM_THREADS		(PMM_TC_MAX_THREADS + 8)
+#define NUM_ROUNDS		100
+#define BATCH_SIZE		48
+
+struct TestObj {
+	int _Owner;
+	int _Round;
+};
+
+// objects waiting to be freed by another thread
+struct Handoff {
+	std::mutex _Lock;
+	std::vector<TestObj *> _Objs;
+};
+
+
+// wait until every thread has reached the same point
+static void Wait_All(std::atomic<int> &arrived) {
+	arrived++;
+	while (arrived.load() < NUM_THREADS) {
+		std::this_thread::yield();
+	}
+}
+
+
+int main(void) {
+	PSTD::PoolMemManagerTC<TestObj> pool(64, true, 16);
+	std::atomic<int> errors(0);
+	std::atomic<int> depotThreads(0);
+	std::atomic<int> started(0);
+	std::atomic<int> finished(0);
+	std::vector<Handoff> handoff(NUM_THREADS);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < NUM_THREADS; t++) {
+		threads.push_back(std::thread([&, t]() {
+			// all threads are alive together so the thread slots run past the magazines
+			if (PSTD::PThreadSlot::Get_Slot() >= PMM_TC_MAX_THREADS) {
+				depotThreads++;
+			}
+			Wait_All(started);
+
+			std::vector<TestObj *> objs;
+			std::vector<TestObj *> received;
+			for (int round = 0; round < NUM_ROUNDS; round++) {
+				for (int i = 0; i < BATCH_SIZE; i++) {
+					TestObj *obj = pool.Allocate_Object();
+					if (!obj) {
+						errors++;
+						continue;
+					}
+					obj->_Owner = t;
+					obj->_Round = round;
+					objs.push_back(obj);
+				}
+				for (size_t i = 0; i < objs.size(); i++) {
+					if ((objs[i]->_Owner != t) || (objs[i]->_Round != round)) {
+						errors++;
+					}
+				}
+
+				// the first half goes to the next thread, the rest is freed here
+				size_t half = objs.size() / 2;
+				{
+					std::lock_guard<std::mutex> lock(handoff[(t + 1) % NUM_THREADS]._Lock);
+					std::vector<TestObj *> &dest = handoff[(t + 1) % NUM_THREADS]._Objs;
+					dest.insert(dest.end(), objs.begin(), objs.begin() + half);
+				}
+				for (size_t i = half; i < objs.size(); i++) {
+					pool.Free_Object(objs[i]);
+				}
+				objs.clear();
+
+				{
+					std::lock_guard<std::mutex> lock(handoff[t]._Lock);
+					received.swap(handoff[t]._Objs);
+				}
+				for (size_t i = 0; i < received.size(); i++) {
+					pool.Free_Object(received[i]);
+				}
+				received.clear();
+			}
+
+			// stay alive until everyone is done so no thread slot is recycled mid run
+			Wait_All(finished);
+		}));
+	}
+	for (int t = 0; t < NUM_THREADS; t++) {
+		threads[t].join();
+	}
+	for (int t = 0; t < NUM_THREADS; t++) {
+		for (size_t i = 0; i < handoff[t]._Objs.size(); i++) {
+			pool.Free_Object(handoff[t]._Objs[i]);
+		}
+	}
+
+	if (!depotThreads.load()) {
+		errors++;
+	}
+
+	printf("PoolMemManagerTC threads: %s (%d threads without a magazine)\n", (errors.load()) ? "FAILED" : "ok", depotThreads.load());
+	return (errors.load()) ? 1 : 0;
+}